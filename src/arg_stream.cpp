@@ -0,0 +1,398 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// This file is part of the romato library.
+//
+// Copyright 2013-2026 Rocco Matano
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "romato.h"
+#include "cmdl_parse.h"
+#include "arg_stream.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Response files are mapped in windows of this size. Lines must not be
+// longer, longer ones are split.
+static const size_t WINDOW_SIZE = 64 * 1024 * 1024;
+
+////////////////////////////////////////////////////////////////////////////////
+
+struct ArgStream::Source
+{
+    // current line (or the command line), parsed in place
+    PCWSTR cursor;
+    UINT line_len;
+    cvector<WCHAR> line;
+
+    // response file, all zero for the command line
+    HANDLE file;
+    HANDLE mapping;
+    const BYTE* view;
+    UINT64 view_offset;
+    size_t view_size;
+    UINT64 size;
+    UINT64 pos;
+    UINT64 granularity;
+    bool utf16;
+
+    Source() :
+        cursor(nullptr),
+        line_len(0),
+        file(INVALID_HANDLE_VALUE),
+        mapping(nullptr),
+        view(nullptr),
+        view_offset(0),
+        view_size(0),
+        size(0),
+        pos(0),
+        granularity(0),
+        utf16(false)
+    {
+    }
+
+    ~Source()
+    {
+        if (view)
+        {
+            UnmapViewOfFile(view);
+        }
+        if (mapping)
+        {
+            CloseHandle(mapping);
+        }
+        if (file != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(file);
+        }
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+ArgStream::ArgStream() : m_error(0)
+{
+    push_cmdl(GetCommandLineW());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+ArgStream::ArgStream(PCWSTR cmdl) : m_error(0)
+{
+    push_cmdl(cmdl);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+ArgStream::~ArgStream()
+{
+    while (!m_sources.empty())
+    {
+        pop();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ArgStream::push_cmdl(PCWSTR cmdl)
+{
+    auto src = new Source;
+    src->cursor = cmdl ? cmdl : L"";
+    src->line_len = simd_len(src->cursor);
+    m_sources.push_back(src);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ArgStream::pop()
+{
+    delete m_sources.back();
+    m_sources.pop_back();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Maps the window that contains 'src->pos' and as much as possible behind
+// it.
+bool ArgStream::map_window(Source* src)
+{
+    if (src->view)
+    {
+        UnmapViewOfFile(src->view);
+    }
+    const UINT64 offset = src->pos - src->pos % src->granularity;
+    const UINT64 rest = src->size - offset;
+    const size_t len = (
+        rest < WINDOW_SIZE ?
+        static_cast<size_t>(rest) :
+        WINDOW_SIZE
+        );
+    src->view = static_cast<const BYTE*>(
+        MapViewOfFile(
+            src->mapping,
+            FILE_MAP_READ,
+            static_cast<DWORD>(offset >> 32),
+            static_cast<DWORD>(offset),
+            len
+            )
+        );
+    src->view_offset = offset;
+    src->view_size = src->view ? len : 0;
+    return src->view != nullptr;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool ArgStream::push_file(PCWSTR path)
+{
+    HANDLE file = CreateFileW(
+        path,
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_FLAG_SEQUENTIAL_SCAN,
+        nullptr
+        );
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    auto src = new Source;
+    src->file = file;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size))
+    {
+        const DWORD err = GetLastError();
+        delete src;
+        SetLastError(err);
+        return false;
+    }
+    src->size = size.QuadPart;
+
+    // CreateFileMapping refuses empty files
+    if (src->size)
+    {
+        SYSTEM_INFO si;
+        GetSystemInfo(&si);
+        src->granularity = si.dwAllocationGranularity;
+        src->mapping = CreateFileMappingW(
+            file,
+            nullptr,
+            PAGE_READONLY,
+            0,
+            0,
+            nullptr
+            );
+        if (!src->mapping || !map_window(src))
+        {
+            const DWORD err = GetLastError();
+            delete src;
+            SetLastError(err);
+            return false;
+        }
+
+        const BYTE* bytes = src->view;
+        const size_t num = src->view_size;
+        if (
+            num >= 3 &&
+            bytes[0] == 0xef &&
+            bytes[1] == 0xbb &&
+            bytes[2] == 0xbf
+            )
+        {
+            src->pos = 3;
+        }
+        else if (num >= 2 && bytes[0] == 0xff && bytes[1] == 0xfe)
+        {
+            src->pos = 2;
+            src->utf16 = true;
+        }
+        else
+        {
+            // Text in UTF-16LE that is mostly ASCII (like paths usually are)
+            // has zero in nearly every odd byte, UTF-8 never has any.
+            const size_t sample = (num < 4096 ? num : 4096) & ~1;
+            size_t zeros = 0;
+            for (size_t i = 1; i < sample; i += 2)
+            {
+                zeros += (bytes[i] == 0);
+            }
+            src->utf16 = sample && zeros > sample / 4;
+        }
+    }
+    m_sources.push_back(src);
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Reads the next line of a response file into 'src->line'. Returns false at
+// the end of the file (or for the command line).
+bool ArgStream::read_line(Source* src)
+{
+    if (!src->mapping || src->pos >= src->size)
+    {
+        return false;
+    }
+    if (src->pos >= src->view_offset + src->view_size && !map_window(src))
+    {
+        m_error = GetLastError();
+        return false;
+    }
+
+    const size_t char_size = src->utf16 ? sizeof(WCHAR) : 1;
+    const BYTE* first;
+    const BYTE* end;
+    const BYTE* eol;
+    for (;;)
+    {
+        first = src->view + (src->pos - src->view_offset);
+        end = src->view + src->view_size;
+        if (src->utf16)
+        {
+            auto p = p2p<PCWSTR>(first);
+            auto wend = p2p<PCWSTR>(first + ((end - first) & ~1));
+            while (p < wend && *p != L'\n')
+            {
+                ++p;
+            }
+            eol = p2p<const BYTE*>(p);
+            end = p2p<const BYTE*>(wend);
+        }
+        else
+        {
+            eol = first;
+            while (eol < end && *eol != '\n')
+            {
+                ++eol;
+            }
+        }
+
+        // Move the window to the start of the line, if the line reaches
+        // beyond it and that helps.
+        if (
+            eol != end ||
+            src->view_offset + src->view_size >= src->size ||
+            src->pos - src->pos % src->granularity == src->view_offset
+            )
+        {
+            break;
+        }
+        if (!map_window(src))
+        {
+            m_error = GetLastError();
+            return false;
+        }
+    }
+
+    const size_t bytes = eol - first;
+    src->pos += bytes + (eol != end ? char_size : 0);
+    if (eol == end && src->pos < src->size)
+    {
+        // odd trailing byte of a UTF-16 file
+        src->pos = src->size;
+    }
+
+    UINT len;
+    src->line.resize(bytes / char_size + 1);
+    if (src->utf16)
+    {
+        len = static_cast<UINT>(bytes / sizeof(WCHAR));
+        memcpy(src->line.data(), first, len * sizeof(WCHAR));
+    }
+    else
+    {
+        len = bytes ? MultiByteToWideChar(
+            CP_UTF8,
+            0,
+            p2p<LPCCH>(first),
+            static_cast<int>(bytes),
+            src->line.data(),
+            static_cast<int>(bytes)
+            ) : 0;
+    }
+    if (len && src->line[len - 1] == L'\r')
+    {
+        --len;
+    }
+    src->line[len] = 0;
+    src->cursor = src->line.data();
+    src->line_len = len;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool ArgStream::next(Yast& arg)
+{
+    while (m_error == 0 && !m_sources.empty())
+    {
+        Source* src = m_sources.back();
+        PCWSTR cur = src->cursor ? cmdl_skip_space(src->cursor) : nullptr;
+        if (!cur || *cur == 0)
+        {
+            if (!read_line(src))
+            {
+                if (m_error)
+                {
+                    return false;
+                }
+                pop();
+            }
+            continue;
+        }
+
+        if (m_arg.size() <= src->line_len)
+        {
+            m_arg.resize(src->line_len + 1);
+        }
+        PWSTR dst = m_arg.data();
+        src->cursor = cmdl_unescape_arg(cur, dst);
+        const UINT len = static_cast<UINT>(dst - m_arg.data());
+
+        if (len > 1 && m_arg[0] == L'@')
+        {
+            *dst = 0;
+            PCWSTR path = m_arg.data() + 1;
+            if (m_sources.size() > MAX_DEPTH)
+            {
+                m_error = ERROR_NESTING_NOT_ALLOWED;
+                m_error_path = path;
+                return false;
+            }
+            if (!push_file(path))
+            {
+                m_error = GetLastError();
+                m_error_path = path;
+                return false;
+            }
+            continue;
+        }
+
+        arg = Yast(m_arg.data(), len);
+        return true;
+    }
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
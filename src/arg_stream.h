@@ -0,0 +1,100 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// This file is part of the romato library.
+//
+// Copyright 2013-2026 Rocco Matano
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Lazy iteration over the arguments of a command line with response file
+// expansion: an argument of the form '@path' is replaced by the arguments
+// that are read from the file 'path'. Response files may contain further
+// '@path' arguments, up to a nesting depth of MAX_DEPTH.
+//
+// Response files are mapped into memory one window at a time, so even files
+// of several GB are never read as a whole, and only one argument is unescaped
+// at a time. Every line of a response file is parsed like a command line
+// (same rules for quotation marks and backslashes as cmdl_to_argv), i.e.
+// line breaks delimit arguments as well and quoted arguments cannot span
+// lines. The encoding is taken from a byte order mark (UTF-8 or UTF-16LE).
+// Without one, a file where most of the odd bytes are zero is taken as
+// UTF-16LE, anything else as UTF-8.
+//
+// If a response file cannot be opened or the nesting is too deep, next()
+// returns false and error() tells why.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+class ArgStream
+{
+public:
+
+    static const UINT MAX_DEPTH = 16;
+
+    // Iterates the command line of the process (including the program name,
+    // just like get_argv).
+    ArgStream();
+
+    // 'cmdl' has to outlive this object.
+    explicit ArgStream(PCWSTR cmdl);
+
+    ~ArgStream();
+
+    ArgStream(const ArgStream&) = delete;
+    ArgStream& operator=(const ArgStream&) = delete;
+
+    // Stores the next argument in 'arg'. Returns false if there are no more
+    // arguments or an error occurred.
+    bool next(Yast& arg);
+
+    // Win32 error code of the failure that stopped the iteration or 0.
+    DWORD error() const
+    {
+        return m_error;
+    }
+
+    // The response file that caused error().
+    const Yast& error_path() const
+    {
+        return m_error_path;
+    }
+
+protected:
+
+    struct Source;
+
+    void push_cmdl(PCWSTR cmdl);
+    bool push_file(PCWSTR path);
+    void pop();
+    static bool map_window(Source* src);
+    bool read_line(Source* src);
+
+    cvector<Source*> m_sources;
+    cvector<WCHAR> m_arg;
+    DWORD m_error;
+    Yast m_error_path;
+};
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,159 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// This file is part of the romato library.
+//
+// Copyright 2013-2026 Rocco Matano
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "romato_simd.h"
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Building blocks for parsing a command line in a single scan. They are
+// templates over the character type, so that cmdl_to_argv and the view based
+// variants share the very same parser for TCHAR.
+//
+// Unescaping never makes an argument longer and every argument is followed by
+// a delimiter or the end of the command line. So len + 1 characters are
+// always enough for all arguments and their terminating zeros, and there are
+// at most len / 2 + 1 arguments.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+template <class T> inline bool cmdl_is_space(T c)
+{
+    return c == T(' ') || c == T('\t');
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <class T> inline const T* cmdl_skip_space(const T* src)
+{
+    while (cmdl_is_space(*src))
+    {
+        ++src;
+    }
+    return src;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Returns the end of the run of characters at 'src' that need no special
+// treatment outside of quotation marks. If that end is white space or the
+// end of the command line, [src, end) is a complete argument that is
+// identical to its unescaped form.
+template <class T> inline const T* cmdl_plain_end(const T* src)
+{
+    return simd_find(src, [](__m128i v)
+        {
+            return _mm_or_si128(
+                _mm_or_si128(simd_eq(v, T(' ')), simd_eq(v, T('\t'))),
+                _mm_or_si128(simd_eq(v, T('"')), simd_eq(v, T('\\')))
+                );
+        });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Unescapes the argument that starts at 'src' (which must not be white space
+// or the end of the command line) to 'dst'. Returns the position after the
+// argument and advances 'dst' behind the last written character (no
+// terminating zero is written).
+//
+// - A string of backslashes not followed by a quotation mark has no special
+//   meaning.
+// - An even number of backslashes followed by a quotation mark is treated as
+//   pairs of protected backslashes, followed by a word terminator.
+// - An odd number of backslashes followed by a quotation mark is treated as
+//   pairs of protected backslashes, followed by a protected quotation mark.
+// - Quotation marks switch whether white space terminates the argument. Two
+//   quotation marks in a row inside quotation marks yield one.
+
+template <class T> const T* cmdl_unescape_arg(const T* src, T*& dst)
+{
+    bool space_terminates_arg = true;
+    for (;;)
+    {
+        // copy the run of ordinary characters in one go
+        const T* run = (
+            space_terminates_arg ?
+            cmdl_plain_end(src) :
+            simd_find(src, [](__m128i v)
+                {
+                    return _mm_or_si128(
+                        simd_eq(v, T('"')),
+                        simd_eq(v, T('\\'))
+                        );
+                })
+            );
+        while (src != run)
+        {
+            *dst++ = *src++;
+        }
+
+        int cnt_backslash = 0;
+        while (*src == T('\\'))
+        {
+            ++src;
+            ++cnt_backslash;
+        }
+
+        bool ignore = false;
+        if (*src == T('"'))
+        {
+            if (cnt_backslash % 2 == 0)
+            {
+                if (!space_terminates_arg && src[1] == T('"'))
+                {
+                    ++src;
+                }
+                else
+                {
+                    // toggle mode and ignore the quotation mark
+                    space_terminates_arg = !space_terminates_arg;
+                    ignore = true;
+                }
+            }
+            cnt_backslash /= 2;
+        }
+
+        while (cnt_backslash--)
+        {
+            *dst++ = T('\\');
+        }
+
+        if (*src == 0 || (space_terminates_arg && cmdl_is_space(*src)))
+        {
+            return src;
+        }
+
+        if (!ignore)
+        {
+            *dst++ = *src;
+        }
+        ++src;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
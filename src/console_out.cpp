@@ -0,0 +1,373 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// This file is part of the romato library.
+//
+// Copyright 2013-2026 Rocco Matano
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "romato.h"
+#include "console_out.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Constant initialized, no static constructor required.
+ConsoleOut g_stdout(STD_OUTPUT_HANDLE, false);
+ConsoleOut g_stderr(STD_ERROR_HANDLE, true);
+
+static INIT_ONCE s_exit_once = INIT_ONCE_STATIC_INIT;
+
+////////////////////////////////////////////////////////////////////////////////
+
+static void __cdecl FlushStdHandles()
+{
+    g_stdout.flush();
+    g_stderr.flush();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+static BOOL CALLBACK RegisterFlush(INIT_ONCE*, void*, void**)
+{
+    atexit(FlushStdHandles);
+    return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+ConsoleOut::ConsoleOut(HANDLE handle, size_t buffer_size) :
+    m_std_handle(0),
+    m_handle(handle),
+    m_buf(nullptr),
+    m_size(buffer_size < MIN_BUFFER_SIZE ? MIN_BUFFER_SIZE : buffer_size),
+    m_len(0),
+    m_is_console(false),
+    m_initialized(false),
+    m_write_through(false)
+{
+    InitializeSRWLock(&m_lock);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+ConsoleOut::~ConsoleOut()
+{
+    flush();
+    free(m_buf);
+
+    // in case this is a standard handle and somebody writes even later
+    m_buf = nullptr;
+    m_initialized = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ConsoleOut::init()
+{
+    if (m_initialized)
+    {
+        return;
+    }
+    if (m_std_handle)
+    {
+        m_handle = GetStdHandle(m_std_handle);
+        InitOnceExecuteOnce(&s_exit_once, RegisterFlush, nullptr, nullptr);
+    }
+    DWORD mode;
+    m_is_console = GetConsoleMode(m_handle, &mode) != FALSE;
+    m_buf = static_cast<char*>(malloc(m_size));
+    m_len = 0;
+    m_initialized = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ConsoleOut::set_buffer_size(size_t size)
+{
+    AcquireSRWLockExclusive(&m_lock);
+    flush_locked();
+    free(m_buf);
+    m_buf = nullptr;
+    m_size = size < MIN_BUFFER_SIZE ? MIN_BUFFER_SIZE : size;
+    if (m_initialized)
+    {
+        m_buf = static_cast<char*>(malloc(m_size));
+    }
+    ReleaseSRWLockExclusive(&m_lock);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool ConsoleOut::write_handle(const char* data, size_t len)
+{
+    while (len)
+    {
+        const DWORD max_write = 0x40000000;
+        DWORD num = len < max_write ? static_cast<DWORD>(len) : max_write;
+        if (!WriteFile(m_handle, data, num, &num, nullptr) || !num)
+        {
+            return false;
+        }
+        data += num;
+        len -= num;
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool ConsoleOut::flush_locked()
+{
+    if (!m_len)
+    {
+        return true;
+    }
+    const bool ok = write_handle(m_buf, m_len);
+    m_len = 0;
+    return ok;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool ConsoleOut::done_locked(bool ok)
+{
+    if (m_write_through)
+    {
+        ok = flush_locked() && ok;
+    }
+    ReleaseSRWLockExclusive(&m_lock);
+    return ok;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool ConsoleOut::flush()
+{
+    AcquireSRWLockExclusive(&m_lock);
+    const bool ok = m_initialized ? flush_locked() : true;
+    ReleaseSRWLockExclusive(&m_lock);
+    return ok;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool ConsoleOut::append(const char* data, size_t len)
+{
+    if (len > m_size - m_len)
+    {
+        if (!flush_locked())
+        {
+            return false;
+        }
+        if (len >= m_size)
+        {
+            return write_handle(data, len);
+        }
+    }
+    memcpy(m_buf + m_len, data, len);
+    m_len += len;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool ConsoleOut::append(const WCHAR* data, size_t len)
+{
+    if (m_is_console)
+    {
+        // keep the order of the output
+        if (!flush_locked())
+        {
+            return false;
+        }
+        while (len)
+        {
+            const DWORD max_write = 0x4000;
+            DWORD num = len < max_write ? static_cast<DWORD>(len) : max_write;
+            if (!WriteConsoleW(m_handle, data, num, &num, nullptr) || !num)
+            {
+                return false;
+            }
+            data += num;
+            len -= num;
+        }
+        return true;
+    }
+
+    // Convert to UTF-8 directly into the buffer. A UTF-16 code unit never
+    // needs more than 3 bytes, but a surrogate pair must not be split.
+    while (len)
+    {
+        size_t num = (m_size - m_len) / 3;
+        if (num < 2)
+        {
+            if (!flush_locked())
+            {
+                return false;
+            }
+            continue;
+        }
+        if (num >= len)
+        {
+            num = len;
+        }
+        else if (IS_HIGH_SURROGATE(data[num - 1]))
+        {
+            num--;
+        }
+        const int res = WideCharToMultiByte(
+            CP_UTF8,
+            0,
+            data,
+            static_cast<int>(num),
+            m_buf + m_len,
+            static_cast<int>(m_size - m_len),
+            nullptr,
+            nullptr
+            );
+        if (res <= 0)
+        {
+            return false;
+        }
+        m_len += res;
+        data += num;
+        len -= num;
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool ConsoleOut::write(const char* data, size_t len)
+{
+    AcquireSRWLockExclusive(&m_lock);
+    init();
+    return done_locked(append(data, len));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool ConsoleOut::write(const WCHAR* data, size_t len)
+{
+    AcquireSRWLockExclusive(&m_lock);
+    init();
+    return done_locked(append(data, len));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool ConsoleOut::puts(const char* str)
+{
+    AcquireSRWLockExclusive(&m_lock);
+    init();
+    return done_locked(append(str, sz_lenA(str)) && append("\n", 1));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool ConsoleOut::puts(const WCHAR* str)
+{
+    AcquireSRWLockExclusive(&m_lock);
+    init();
+    return done_locked(append(str, sz_lenW(str)) && append(L"\n", 1));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int ConsoleOut::vprintf(const char* fmt, va_list args)
+{
+    AcquireSRWLockExclusive(&m_lock);
+    init();
+
+    // Format directly into the buffer. If that is too small, flush and try
+    // again. If it is still too small, use a temporary buffer.
+    const UINT avail = static_cast<UINT>(m_size - m_len);
+    int res = sz_vnprintfA(m_buf + m_len, avail, fmt, args);
+    bool ok = res >= 0;
+    if (ok && static_cast<UINT>(res) < avail)
+    {
+        m_len += res;
+    }
+    else if (ok)
+    {
+        // whatever was formatted so far is discarded by m_len not changing
+        ok = flush_locked();
+        if (ok && static_cast<size_t>(res) < m_size)
+        {
+            m_len = sz_vnprintfA(m_buf, static_cast<UINT>(m_size), fmt, args);
+        }
+        else if (ok)
+        {
+            auto tmp = static_cast<char*>(malloc(res + 1));
+            sz_vnprintfA(tmp, res + 1, fmt, args);
+            ok = write_handle(tmp, res);
+            free(tmp);
+        }
+    }
+    return done_locked(ok) ? res : -1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int ConsoleOut::vprintf(const WCHAR* fmt, va_list args)
+{
+    AcquireSRWLockExclusive(&m_lock);
+    init();
+
+    WCHAR stack_buf[512];
+    WCHAR* buf = stack_buf;
+    int res = sz_vnprintfW(buf, ARRAY_SIZE(stack_buf), fmt, args);
+    if (res >= static_cast<int>(ARRAY_SIZE(stack_buf)))
+    {
+        buf = static_cast<WCHAR*>(malloc((res + 1) * sizeof(WCHAR)));
+        sz_vnprintfW(buf, res + 1, fmt, args);
+    }
+    bool ok = res >= 0 && append(buf, res);
+    if (buf != stack_buf)
+    {
+        free(buf);
+    }
+    return done_locked(ok) ? res : -1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int ConsoleOut::printf(const char* fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    const int res = vprintf(fmt, args);
+    va_end(args);
+    return res;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int ConsoleOut::printf(const WCHAR* fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    const int res = vprintf(fmt, args);
+    va_end(args);
+    return res;
+}
+
+////////////////////////////////////////////////////////////////////////////////
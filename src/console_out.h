@@ -0,0 +1,128 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// This file is part of the romato library.
+//
+// Copyright 2013-2026 Rocco Matano
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Buffered output to the console, a pipe or a file.
+//
+// The output is collected in a buffer (DEFAULT_BUFFER_SIZE unless changed by
+// set_buffer_size) and written with a single WriteFile when it is full, when
+// flush() is called or when the program ends (the standard handles are
+// flushed by a terminator that is registered with atexit). Formatted output
+// is never truncated, if it does not fit into the buffer, it is written
+// directly.
+//
+// 8 bit text is written as it is. UTF-16 text goes to WriteConsoleW if the
+// handle is a console, otherwise it is converted to UTF-8.
+//
+// All methods may be called by several threads, every call is atomic with
+// respect to the others.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+class ConsoleOut
+{
+public:
+
+    static const size_t DEFAULT_BUFFER_SIZE = 16 * 1024;
+    static const size_t MIN_BUFFER_SIZE = 256;
+
+    // For one of the standard handles (STD_OUTPUT_HANDLE, STD_ERROR_HANDLE).
+    // Constant initialized, so it can be used for objects with static
+    // storage duration. The handle is queried on first use. With
+    // 'write_through' every call is flushed (as for stderr).
+    constexpr explicit ConsoleOut(DWORD std_handle, bool write_through) :
+        m_std_handle(std_handle),
+        m_handle(nullptr),
+        m_buf(nullptr),
+        m_size(DEFAULT_BUFFER_SIZE),
+        m_len(0),
+        m_is_console(false),
+        m_initialized(false),
+        m_write_through(write_through),
+        m_lock{} // SRWLOCK_INIT
+    {
+    }
+
+    // For any handle that can be written by WriteFile. The handle is not
+    // closed by the destructor.
+    explicit ConsoleOut(
+        HANDLE handle,
+        size_t buffer_size = DEFAULT_BUFFER_SIZE
+        );
+
+    ~ConsoleOut();
+
+    ConsoleOut(const ConsoleOut&) = delete;
+    ConsoleOut& operator=(const ConsoleOut&) = delete;
+
+    // Flushes the current content.
+    void set_buffer_size(size_t size);
+
+    bool write(const char* data, size_t len);
+    bool write(const WCHAR* data, size_t len);
+
+    // Like the C function, appends a line break.
+    bool puts(const char* str);
+    bool puts(const WCHAR* str);
+
+    // Return the number of characters or -1 on error.
+    int printf(const char* fmt, ...);
+    int printf(const WCHAR* fmt, ...);
+    int vprintf(const char* fmt, va_list args);
+    int vprintf(const WCHAR* fmt, va_list args);
+
+    bool flush();
+
+protected:
+
+    // these expect m_lock to be held
+    void init();
+    bool append(const char* data, size_t len);
+    bool append(const WCHAR* data, size_t len);
+    bool flush_locked();
+    bool done_locked(bool ok); // releases m_lock
+    bool write_handle(const char* data, size_t len);
+
+    DWORD m_std_handle;
+    HANDLE m_handle;
+    char* m_buf;
+    size_t m_size;
+    size_t m_len;
+    bool m_is_console;
+    bool m_initialized;
+    bool m_write_through;
+    SRWLOCK m_lock;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+extern ConsoleOut g_stdout;
+extern ConsoleOut g_stderr;
+
+////////////////////////////////////////////////////////////////////////////////
@@ -321,3 +321,325 @@ operator+(ptrdiff_t offs, array_iterator<T> next)
 }
 
 ////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Bounded lock-free ring buffers for handing over objects between threads
+// (e.g. from workers to the UI thread) without a heap allocation per item.
+// The capacity has to be a power of two. Storage is obtained through CustAll
+// once, when the ring is constructed. Objects are moved in and out, so
+// carrying a Yast does not copy its characters.
+//
+// spsc_ring: exactly one producer and exactly one consumer thread.
+// mpsc_ring: any number of producer threads, exactly one consumer thread.
+//
+// Both return false (or a short count for the batch versions) instead of
+// blocking, when the ring is full or empty.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <atomic>
+#include <utility>
+
+#ifndef ROMATO_CACHE_LINE
+#define ROMATO_CACHE_LINE 64
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <class T> class spsc_ring
+{
+public:
+    using value_type = T;
+
+    explicit spsc_ring(size_t capacity) :
+        m_slots(CustAll<T>().allocate(capacity)),
+        m_mask(capacity - 1),
+        m_head(0),
+        m_tail_cache(0),
+        m_tail(0),
+        m_head_cache(0)
+    {
+        if (capacity < 2 || !IS_POW_2(capacity))
+        {
+            RaiseException(E_INVALIDARG);
+        }
+    }
+
+    spsc_ring(const spsc_ring&) = delete;
+    spsc_ring& operator=(const spsc_ring&) = delete;
+
+    ~spsc_ring()
+    {
+        T tmp;
+        while (try_pop(tmp))
+        {
+        }
+        CustAll<T>().deallocate(m_slots, m_mask + 1);
+    }
+
+    size_t capacity() const
+    {
+        return m_mask + 1;
+    }
+
+    // Only a snapshot, since the other side might be busy.
+    size_t size_approx() const
+    {
+        return (
+            m_tail.load(std::memory_order_acquire) -
+            m_head.load(std::memory_order_acquire)
+            );
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // producer side
+
+    bool try_push(T&& val)
+    {
+        return push_batch(&val, 1) == 1;
+    }
+
+    bool try_push(const T& val)
+    {
+        T tmp(val);
+        return push_batch(&tmp, 1) == 1;
+    }
+
+    // Moves up to 'num' items from 'vals' into the ring and publishes them
+    // all at once. Returns the number of items that were moved.
+    size_t push_batch(T* vals, size_t num)
+    {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        size_t avail = capacity() - (tail - m_head_cache);
+        if (avail < num)
+        {
+            m_head_cache = m_head.load(std::memory_order_acquire);
+            avail = capacity() - (tail - m_head_cache);
+        }
+        if (num > avail)
+        {
+            num = avail;
+        }
+        for (size_t i = 0; i < num; i++)
+        {
+            new (&m_slots[(tail + i) & m_mask]) T(std::move(vals[i]));
+        }
+        m_tail.store(tail + num, std::memory_order_release);
+        return num;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // consumer side
+
+    bool try_pop(T& val)
+    {
+        return pop_batch(&val, 1) == 1;
+    }
+
+    // Moves up to 'num' items out of the ring into 'vals' and releases their
+    // slots all at once. Returns the number of items that were moved.
+    size_t pop_batch(T* vals, size_t num)
+    {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        size_t avail = m_tail_cache - head;
+        if (avail < num)
+        {
+            m_tail_cache = m_tail.load(std::memory_order_acquire);
+            avail = m_tail_cache - head;
+        }
+        if (num > avail)
+        {
+            num = avail;
+        }
+        for (size_t i = 0; i < num; i++)
+        {
+            T* const slot = &m_slots[(head + i) & m_mask];
+            vals[i] = std::move(*slot);
+            slot->~T();
+        }
+        m_head.store(head + num, std::memory_order_release);
+        return num;
+    }
+
+protected:
+
+    // Read-only after construction, shared by both sides.
+    T* const m_slots;
+    const size_t m_mask;
+    char m_pad0[ROMATO_CACHE_LINE - sizeof(T*) - sizeof(size_t)];
+
+    // Written by the consumer.
+    std::atomic<size_t> m_head;
+    size_t m_tail_cache;
+    char m_pad1[ROMATO_CACHE_LINE - 2 * sizeof(size_t)];
+
+    // Written by the producer.
+    std::atomic<size_t> m_tail;
+    size_t m_head_cache;
+    char m_pad2[ROMATO_CACHE_LINE - 2 * sizeof(size_t)];
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Based on Dmitry Vyukov's bounded MPMC queue: every slot carries a sequence
+// number, that tells producers and the consumer whether the slot is free or
+// filled for the current lap. Producers claim slots by advancing the tail with
+// a CAS. Since there is only one consumer, it does not need a CAS.
+
+template <class T> class mpsc_ring
+{
+public:
+    using value_type = T;
+
+    explicit mpsc_ring(size_t capacity) :
+        m_slots(CustAll<slot>().allocate(capacity)),
+        m_mask(capacity - 1),
+        m_head(0),
+        m_tail(0)
+    {
+        if (capacity < 2 || !IS_POW_2(capacity))
+        {
+            RaiseException(E_INVALIDARG);
+        }
+        for (size_t i = 0; i < capacity; i++)
+        {
+            m_slots[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    mpsc_ring(const mpsc_ring&) = delete;
+    mpsc_ring& operator=(const mpsc_ring&) = delete;
+
+    ~mpsc_ring()
+    {
+        T tmp;
+        while (try_pop(tmp))
+        {
+        }
+        CustAll<slot>().deallocate(m_slots, m_mask + 1);
+    }
+
+    size_t capacity() const
+    {
+        return m_mask + 1;
+    }
+
+    size_t size_approx() const
+    {
+        return (
+            m_tail.load(std::memory_order_acquire) -
+            m_head.load(std::memory_order_acquire)
+            );
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // producer side (any thread)
+
+    bool try_push(T&& val)
+    {
+        size_t pos = m_tail.load(std::memory_order_relaxed);
+        slot* s;
+        for (;;)
+        {
+            s = &m_slots[pos & m_mask];
+            const size_t seq = s->seq.load(std::memory_order_acquire);
+            const intptr_t dif = static_cast<intptr_t>(seq - pos);
+            if (dif == 0)
+            {
+                if (
+                    m_tail.compare_exchange_weak(
+                        pos,
+                        pos + 1,
+                        std::memory_order_relaxed
+                        )
+                    )
+                {
+                    break;
+                }
+            }
+            else if (dif < 0)
+            {
+                // full
+                return false;
+            }
+            else
+            {
+                pos = m_tail.load(std::memory_order_relaxed);
+            }
+        }
+        new (s->storage) T(std::move(val));
+        s->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_push(const T& val)
+    {
+        T tmp(val);
+        return try_push(std::move(tmp));
+    }
+
+    // Producers compete for every single slot, so this is merely a
+    // convenience loop. Returns the number of items that were moved.
+    size_t push_batch(T* vals, size_t num)
+    {
+        size_t done = 0;
+        while (done < num && try_push(std::move(vals[done])))
+        {
+            ++done;
+        }
+        return done;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // consumer side (one thread only)
+
+    bool try_pop(T& val)
+    {
+        const size_t pos = m_head.load(std::memory_order_relaxed);
+        slot* const s = &m_slots[pos & m_mask];
+        if (s->seq.load(std::memory_order_acquire) != pos + 1)
+        {
+            // empty, or the producer that claimed this slot is not done yet
+            return false;
+        }
+        T* const p = p2p<T*>(s->storage);
+        val = std::move(*p);
+        p->~T();
+        s->seq.store(pos + m_mask + 1, std::memory_order_release);
+        m_head.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t pop_batch(T* vals, size_t num)
+    {
+        size_t done = 0;
+        while (done < num && try_pop(vals[done]))
+        {
+            ++done;
+        }
+        return done;
+    }
+
+protected:
+
+    struct slot
+    {
+        std::atomic<size_t> seq;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    slot* const m_slots;
+    const size_t m_mask;
+    char m_pad0[ROMATO_CACHE_LINE - sizeof(slot*) - sizeof(size_t)];
+
+    // Only written by the consumer.
+    std::atomic<size_t> m_head;
+    char m_pad1[ROMATO_CACHE_LINE - sizeof(size_t)];
+
+    // Written by all producers.
+    std::atomic<size_t> m_tail;
+    char m_pad2[ROMATO_CACHE_LINE - sizeof(size_t)];
+};
+
+////////////////////////////////////////////////////////////////////////////////
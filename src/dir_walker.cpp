@@ -0,0 +1,295 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// This file is part of the romato library.
+//
+// Copyright 2013-2026 Rocco Matano
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "romato.h"
+#include "dir_walker.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+// The directory path is stored right after the header, so a task costs a
+// single allocation.
+struct DirWalker::DirTask
+{
+    DirWalker* walker;
+    UINT len;
+    WCHAR path[ANYSIZE_ARRAY];
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+DirWalker::DirWalker(ThreadPool& pool) :
+    m_group(pool),
+    m_chunk_size(DEFAULT_CHUNK_SIZE),
+    m_with_meta(false),
+    m_func(nullptr),
+    m_ctx(nullptr),
+    m_cancelled(false),
+    m_count(0)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void DirWalker::add_include(PCWSTR pattern)
+{
+    m_includes.push_back(Yast(pattern));
+    m_includes.back().to_lower();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void DirWalker::add_exclude(PCWSTR pattern)
+{
+    m_excludes.push_back(Yast(pattern));
+    m_excludes.back().to_lower();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool DirWalker::match(PCWSTR pattern, PCWSTR name, UINT len)
+{
+    // Greedy matching that only backtracks to the most recent '*', which is
+    // sufficient for this kind of pattern and keeps it linear in practice.
+    PCWSTR star = nullptr;
+    UINT star_pos = 0;
+    UINT pos = 0;
+    while (pos < len)
+    {
+        if (*pattern == '*')
+        {
+            star = ++pattern;
+            star_pos = pos;
+        }
+        else if (*pattern && (*pattern == '?' || *pattern == name[pos]))
+        {
+            ++pattern;
+            ++pos;
+        }
+        else if (star)
+        {
+            pattern = star;
+            pos = ++star_pos;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    while (*pattern == '*')
+    {
+        ++pattern;
+    }
+    return *pattern == 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool DirWalker::accept(
+    const cvector<Yast>& patterns,
+    const cvector<WCHAR>& name,
+    bool if_none
+    ) const
+{
+    if (patterns.empty())
+    {
+        return if_none;
+    }
+    const UINT len = static_cast<UINT>(name.size());
+    for (const auto& pat : patterns)
+    {
+        if (match(pat, name.data(), len))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+UINT64 DirWalker::walk(
+    const PCWSTR* roots,
+    UINT num_roots,
+    DIR_WALK_FUNC func,
+    void* ctx
+    )
+{
+    m_func = func;
+    m_ctx = ctx;
+    m_cancelled.store(false, std::memory_order_relaxed);
+    m_count.store(0, std::memory_order_relaxed);
+
+    for (UINT i = 0; i < num_roots; i++)
+    {
+        UINT len = sz_lenW(roots[i]);
+        while (len && roots[i][len - 1] == '\\')
+        {
+            --len;
+        }
+        spawn(roots[i], len);
+    }
+    m_group.wait();
+    return m_count.load(std::memory_order_relaxed);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void DirWalker::spawn(PCWSTR dir, UINT len)
+{
+    auto task = static_cast<DirTask*>(
+        malloc(sizeof(DirTask) + len * sizeof(WCHAR))
+        );
+    task->walker = this;
+    task->len = len;
+    memcpy(task->path, dir, len * sizeof(WCHAR));
+    task->path[len] = 0;
+    m_group.run(task_proc, task);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void DirWalker::task_proc(void* ctx)
+{
+    auto task = static_cast<DirTask*>(ctx);
+    DirWalker* walker = task->walker;
+    if (!walker->is_cancelled())
+    {
+        walker->scan(task);
+    }
+    free(task);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void DirWalker::deliver(PathBatch& chunk, cvector<DirWalkMeta>& meta)
+{
+    if (chunk.empty())
+    {
+        return;
+    }
+    m_count.fetch_add(chunk.count(), std::memory_order_relaxed);
+    m_func(m_ctx, chunk, m_with_meta ? meta.data() : nullptr);
+    chunk.clear();
+    meta.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void DirWalker::scan(const DirTask* task)
+{
+    // 'buf' holds "<dir>\<name>" of the current entry, the directory part is
+    // only written once.
+    const UINT dir_len = task->len + 1;
+    cvector<WCHAR> buf(task->path, task->path + task->len);
+    buf.push_back('\\');
+    buf.push_back('*');
+    buf.push_back(0);
+
+    WIN32_FIND_DATAW fd;
+    HANDLE hfind = FindFirstFileExW(
+        buf.data(),
+        FindExInfoBasic,
+        &fd,
+        FindExSearchNameMatch,
+        nullptr,
+        FIND_FIRST_EX_LARGE_FETCH
+        );
+    if (hfind == INVALID_HANDLE_VALUE)
+    {
+        return;
+    }
+
+    const bool filtered = !m_includes.empty() || !m_excludes.empty();
+    cvector<WCHAR> lower;
+    PathBatch chunk;
+    cvector<DirWalkMeta> meta;
+    do
+    {
+        PCWSTR name = fd.cFileName;
+        if (name[0] == '.' && (!name[1] || (name[1] == '.' && !name[2])))
+        {
+            continue;
+        }
+        const UINT name_len = sz_lenW(name);
+        const DWORD attr = fd.dwFileAttributes;
+        const bool is_dir = (attr & FILE_ATTRIBUTE_DIRECTORY) != 0;
+
+        if (filtered)
+        {
+            lower.assign(name, name + name_len);
+            CharLowerBuffW(lower.data(), name_len);
+            if (accept(m_excludes, lower, false))
+            {
+                continue;
+            }
+            if (!is_dir && !accept(m_includes, lower, true))
+            {
+                continue;
+            }
+        }
+
+        buf.resize(dir_len);
+        buf.insert(buf.end(), name, name + name_len);
+        if (is_dir)
+        {
+            if (!(attr & FILE_ATTRIBUTE_REPARSE_POINT))
+            {
+                spawn(buf.data(), dir_len + name_len);
+            }
+            continue;
+        }
+
+        chunk.add(buf.data(), dir_len + name_len);
+        if (m_with_meta)
+        {
+            DirWalkMeta dwm;
+            dwm.size = (
+                (static_cast<UINT64>(fd.nFileSizeHigh) << 32) |
+                fd.nFileSizeLow
+                );
+            dwm.mtime = (
+                (static_cast<UINT64>(fd.ftLastWriteTime.dwHighDateTime) << 32) |
+                fd.ftLastWriteTime.dwLowDateTime
+                );
+            dwm.attributes = attr;
+            meta.push_back(dwm);
+        }
+        if (chunk.count() >= m_chunk_size)
+        {
+            deliver(chunk, meta);
+            if (is_cancelled())
+            {
+                break;
+            }
+        }
+    }
+    while (FindNextFileW(hfind, &fd));
+    FindClose(hfind);
+
+    deliver(chunk, meta);
+}
+
+////////////////////////////////////////////////////////////////////////////////
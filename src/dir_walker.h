@@ -0,0 +1,151 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// This file is part of the romato library.
+//
+// Copyright 2013-2026 Rocco Matano
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "path_batch.h"
+#include "thread_pool.h"
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Parallel recursive directory enumeration.
+//
+// Every directory is scanned by its own ThreadPool task (FindFirstFileExW with
+// FindExInfoBasic and FIND_FIRST_EX_LARGE_FETCH), subdirectories become new
+// tasks. The paths of the files that were found are collected in a PathBatch
+// per task and handed to the callback in chunks of 'chunk_size' paths, so the
+// callback is called from several worker threads at the same time.
+//
+// Include and exclude patterns are matched case insensitively against the
+// name of an entry (not the whole path) and may contain '*' and '?'. Include
+// patterns only apply to files, exclude patterns also prune directories. With
+// no include pattern every file is reported. Reparse points (junctions,
+// symbolic links) are not followed.
+//
+// Paths longer than MAX_PATH require the root to be given with the '\\?\'
+// prefix.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+struct DirWalkMeta
+{
+    UINT64 size;
+    UINT64 mtime;       // FILETIME as a 64 bit value
+    DWORD attributes;
+};
+
+// 'meta' is nullptr unless metadata was requested. Otherwise it holds one
+// element per path of 'paths'.
+using DIR_WALK_FUNC = void(*)(
+    void* ctx,
+    const PathBatch& paths,
+    const DirWalkMeta* meta
+    );
+
+class DirWalker
+{
+public:
+
+    explicit DirWalker(ThreadPool& pool);
+
+    DirWalker(const DirWalker&) = delete;
+    DirWalker& operator=(const DirWalker&) = delete;
+
+    // configuration, has to be done before calling walk()
+
+    void add_include(PCWSTR pattern);
+    void add_exclude(PCWSTR pattern);
+
+    void set_chunk_size(UINT chunk_size)
+    {
+        m_chunk_size = chunk_size ? chunk_size : DEFAULT_CHUNK_SIZE;
+    }
+
+    void set_metadata(bool with_meta)
+    {
+        m_with_meta = with_meta;
+    }
+
+    // Walks all 'roots' (directories without trailing backslash) in parallel
+    // and returns when all of them have been scanned. Returns the number of
+    // reported files. If called on a worker thread of the pool, that thread
+    // helps scanning.
+    UINT64 walk(
+        const PCWSTR* roots,
+        UINT num_roots,
+        DIR_WALK_FUNC func,
+        void* ctx
+        );
+
+    UINT64 walk(PCWSTR root, DIR_WALK_FUNC func, void* ctx)
+    {
+        return walk(&root, 1, func, ctx);
+    }
+
+    // May be called from any thread (including the callback) while walk() is
+    // running. Pending directories are skipped.
+    void cancel()
+    {
+        m_cancelled.store(true, std::memory_order_relaxed);
+    }
+
+    bool is_cancelled() const
+    {
+        return m_cancelled.load(std::memory_order_relaxed);
+    }
+
+    // '*' matches any sequence, '?' any single character. Both 'pattern' and
+    // 'name' have to be lower case already.
+    static bool match(PCWSTR pattern, PCWSTR name, UINT len);
+
+    static const UINT DEFAULT_CHUNK_SIZE = 1024;
+
+protected:
+
+    struct DirTask;
+    static void task_proc(void* ctx);
+
+    void spawn(PCWSTR dir, UINT len);
+    void scan(const DirTask* task);
+    void deliver(PathBatch& chunk, cvector<DirWalkMeta>& meta);
+    bool accept(
+        const cvector<Yast>& patterns,
+        const cvector<WCHAR>& name,
+        bool if_none
+        ) const;
+
+    TaskGroup m_group;
+    cvector<Yast> m_includes;
+    cvector<Yast> m_excludes;
+    UINT m_chunk_size;
+    bool m_with_meta;
+    DIR_WALK_FUNC m_func;
+    void* m_ctx;
+    std::atomic<bool> m_cancelled;
+    std::atomic<UINT64> m_count;
+};
+
+////////////////////////////////////////////////////////////////////////////////
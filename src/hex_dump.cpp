@@ -0,0 +1,260 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// This file is part of the romato library.
+//
+// Copyright 2013-2026 Rocco Matano
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "romato.h"
+#include "hex_dump.h"
+#include <emmintrin.h>
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+const UINT OUT_BUF_SIZE = 64 * 1024;
+
+// offset (up to 16 digits) + ": " + 3 chars per byte + "| " + ASCII + '\n'
+const UINT MAX_LINE_SIZE = 16 + 2 + 3 * HEX_DUMP_MAX_WIDTH + 2 +
+    HEX_DUMP_MAX_WIDTH + 1;
+
+// dumps of up to this many lines are formatted in a stack buffer
+const UINT STACK_LINES = 4;
+
+////////////////////////////////////////////////////////////////////////////////
+
+// character for the ASCII column
+struct PrintableTable
+{
+    char chars[256];
+
+    constexpr PrintableTable() : chars{}
+    {
+        for (int i = 0; i < 256; i++)
+        {
+            chars[i] = (i >= ' ' && i <= '~') ? static_cast<char>(i) : '.';
+        }
+    }
+};
+
+constexpr PrintableTable s_printable;
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Converts 16 bytes to 32 lowercase hex digits.
+inline void HexDigits16(const uint8_t* src, char* dst)
+{
+    const __m128i low_nibble = _mm_set1_epi8(0x0f);
+    const __m128i nine = _mm_set1_epi8(9);
+    const __m128i zero_char = _mm_set1_epi8('0');
+    const __m128i letter_gap = _mm_set1_epi8('a' - '0' - 10);
+
+    const __m128i v = _mm_loadu_si128(p2p<const __m128i*>(src));
+    const __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), low_nibble);
+    const __m128i lo = _mm_and_si128(v, low_nibble);
+
+    auto to_hex = [&](__m128i n)
+    {
+        const __m128i letter = _mm_cmpgt_epi8(n, nine);
+        return _mm_add_epi8(
+            _mm_add_epi8(n, zero_char),
+            _mm_and_si128(letter, letter_gap)
+            );
+    };
+    const __m128i h = to_hex(hi);
+    const __m128i l = to_hex(lo);
+    _mm_storeu_si128(p2p<__m128i*>(dst), _mm_unpacklo_epi8(h, l));
+    _mm_storeu_si128(p2p<__m128i*>(dst + 16), _mm_unpackhi_epi8(h, l));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+inline char* PutOffset(char* out, UINT64 offset, UINT digits)
+{
+    static const char hex[] = "0123456789abcdef";
+    for (UINT i = digits; i; i--)
+    {
+        out[i - 1] = hex[offset & 15];
+        offset >>= 4;
+    }
+    out += digits;
+    *out++ = ':';
+    *out++ = ' ';
+    return out;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// One line of 'num' bytes (num < width only for the last line).
+char* PutLine(
+    char* out,
+    const uint8_t* src,
+    UINT num,
+    const HexDumpOptions& opts,
+    const char* seps
+    )
+{
+    // convert in blocks of 16, the last one from a copy so that nothing
+    // behind the end of the data is read
+    char digits[HEX_DUMP_MAX_WIDTH * 2];
+    UINT done = 0;
+    for (; done + 16 <= num; done += 16)
+    {
+        HexDigits16(src + done, digits + 2 * done);
+    }
+    if (done < num)
+    {
+        uint8_t tail[16] = {0};
+        memcpy(tail, src + done, num - done);
+        HexDigits16(tail, digits + 2 * done);
+    }
+
+    const UINT width = opts.bytes_per_line;
+    for (UINT i = 0; i < num; i++)
+    {
+        out[0] = digits[2 * i];
+        out[1] = digits[2 * i + 1];
+        out[2] = seps[i];
+        out += 3;
+    }
+    for (UINT i = num; i < width; i++)
+    {
+        out[0] = ' ';
+        out[1] = ' ';
+        out[2] = seps[i];
+        out += 3;
+    }
+
+    if (opts.show_ascii)
+    {
+        *out++ = '|';
+        *out++ = ' ';
+        for (UINT i = 0; i < num; i++)
+        {
+            out[i] = s_printable.chars[src[i]];
+        }
+        for (UINT i = num; i < width; i++)
+        {
+            out[i] = ' ';
+        }
+        out += width;
+    }
+    else
+    {
+        // no trailing blanks (there is at least one byte in every line)
+        while (out[-1] == ' ')
+        {
+            --out;
+        }
+    }
+    *out++ = '\n';
+    return out;
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+
+void HexDump(
+    const void* data,
+    size_t len,
+    DBG_SINK_FUNC sink,
+    void* ctx,
+    const HexDumpOptions* opts
+    )
+{
+    if (!opts)
+    {
+        opts = &HEX_DUMP_DEFAULTS;
+    }
+    const UINT width = opts->bytes_per_line;
+    if (!width || width > HEX_DUMP_MAX_WIDTH)
+    {
+        RaiseException(E_INVALIDARG);
+    }
+    if (!sink)
+    {
+        sink = DbgSinkDebugString;
+    }
+
+    // the character that follows each byte
+    char seps[HEX_DUMP_MAX_WIDTH];
+    for (UINT i = 0; i < width; i++)
+    {
+        const bool group_end = (
+            opts->group_size &&
+            (i + 1) % opts->group_size == 0 &&
+            i + 1 < width
+            );
+        seps[i] = group_end ? '|' : ' ';
+    }
+
+    // at least 8 digits, 16 if the offsets need them
+    const UINT64 last_offset = opts->base_offset + (len ? len - 1 : 0);
+    const UINT digits = (last_offset >> 32) ? 16 : 8;
+
+    // Small dumps (like the typical DbgDump) get along with the stack, large
+    // ones get a buffer of up to OUT_BUF_SIZE.
+    const size_t lines = (len + width - 1) / width;
+    const size_t buf_size = (
+        lines < OUT_BUF_SIZE / MAX_LINE_SIZE ?
+        lines * MAX_LINE_SIZE :
+        OUT_BUF_SIZE
+        );
+    char stack_buf[STACK_LINES * MAX_LINE_SIZE];
+    auto const buf = (
+        buf_size <= sizeof(stack_buf) ?
+        stack_buf :
+        static_cast<char*>(malloc(buf_size))
+        );
+    char* out = buf;
+    auto src = static_cast<const uint8_t*>(data);
+    UINT64 offset = opts->base_offset;
+    while (len)
+    {
+        if (out + MAX_LINE_SIZE > buf + buf_size)
+        {
+            sink(ctx, buf, out - buf);
+            out = buf;
+        }
+        const UINT num = len < width ? static_cast<UINT>(len) : width;
+        if (opts->show_offset)
+        {
+            out = PutOffset(out, offset, digits);
+        }
+        out = PutLine(out, src, num, *opts, seps);
+        src += num;
+        offset += num;
+        len -= num;
+    }
+    if (out != buf)
+    {
+        sink(ctx, buf, out - buf);
+    }
+    if (buf != stack_buf)
+    {
+        free(buf);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,78 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// This file is part of the romato library.
+//
+// Copyright 2013-2026 Rocco Matano
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "romato_macros.h"
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Hex dumps of large buffers.
+//
+// HexDump() produces the same kind of lines as DbgDump always did (here
+// with 8 bytes per line in groups of 4)
+//
+//   00000010: 30 31 32 33|34 35 36 37 | 01234567
+//
+// but converts 16 bytes at a time to hex digits with SSE2, maps the
+// characters of the ASCII column with a table and collects the output in a
+// 64 KB buffer that is passed to the sink whenever it is full. So dumping
+// megabytes no longer means one sz_nprintfA and one OutputDebugStringA call
+// per line.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+const UINT HEX_DUMP_MAX_WIDTH = 64;
+
+struct HexDumpOptions
+{
+    // number of bytes per line, 1 to HEX_DUMP_MAX_WIDTH
+    UINT bytes_per_line;
+
+    // a '|' separates groups of this many bytes, 0 means no groups
+    UINT group_size;
+
+    // value of the offset that is shown for the first byte
+    UINT64 base_offset;
+
+    bool show_offset;
+    bool show_ascii;
+};
+
+const HexDumpOptions HEX_DUMP_DEFAULTS = {16, 8, 0, true, true};
+
+// Writes a hex dump of 'data' to 'sink' (nullptr means DbgSinkDebugString).
+// 'opts' may be nullptr for HEX_DUMP_DEFAULTS. Raises E_INVALIDARG for an
+// invalid width.
+void HexDump(
+    const void* data,
+    size_t len,
+    DBG_SINK_FUNC sink,
+    void* ctx,
+    const HexDumpOptions* opts = nullptr
+    );
+
+////////////////////////////////////////////////////////////////////////////////
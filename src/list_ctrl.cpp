@@ -53,6 +53,7 @@ CRect ListCtrl::GetSubItemRect(int idx, int col_idx)
 
 void ListCtrl::DeleteAllItems()
 {
+    CacheClear();
     SendMessage(LVM_DELETEALLITEMS, 0, 0);
 }
 
@@ -60,7 +61,12 @@ void ListCtrl::DeleteAllItems()
 
 bool ListCtrl::DeleteItem(int idx)
 {
-    return 0 != SendMessage(LVM_DELETEITEM, idx, 0);
+    if (0 == SendMessage(LVM_DELETEITEM, idx, 0))
+    {
+        return false;
+    }
+    CacheDeleteRow(idx);
+    return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -131,18 +137,115 @@ int ListCtrl::GetSelectionMark()
 
 int ListCtrl::InsertColumn(int idx, LVCOLUMN& column)
 {
-    return static_cast<int>(
+    const int res = static_cast<int>(
         SendMessage(LVM_INSERTCOLUMN, idx, p2lp(&column))
         );
+    if (res >= 0 && m_cache_enabled)
+    {
+        // subitems have been renumbered, simply reload
+        EnableTextCache(false);
+        EnableTextCache(true);
+    }
+    return res;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
 int ListCtrl::InsertItem(LVITEM& item)
 {
-    return static_cast<int>(
+    const int idx = static_cast<int>(
         SendMessage(LVM_INSERTITEM, 0, p2lp(&item))
         );
+    if (idx >= 0)
+    {
+        CacheInsertRow(idx, item);
+    }
+    return idx;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+UINT ListCtrl::InsertItems(
+    const LcTextView* texts,
+    UINT num_cols,
+    const intptr_t* data,
+    UINT num_rows
+    )
+{
+    if (num_rows == 0 || num_cols == 0)
+    {
+        return 0;
+    }
+
+    // One buffer for all views that need a terminating zero.
+    UINT max_len = 0;
+    for (size_t i = 0, n = static_cast<size_t>(num_rows) * num_cols; i < n; i++)
+    {
+        if (texts[i].len != LcTextView::SZ && texts[i].len > max_len)
+        {
+            max_len = texts[i].len;
+        }
+    }
+    cvector<TCHAR> scratch(static_cast<size_t>(max_len) + 1);
+    auto terminated = [&](const LcTextView& view) -> PTSTR
+    {
+        if (view.len == LcTextView::SZ)
+        {
+            return const_cast<PTSTR>(view.str);
+        }
+        memcpy(scratch.data(), view.str, view.len * sizeof(TCHAR));
+        scratch[view.len] = 0;
+        return scratch.data();
+    };
+
+    const int first = GetItemCount();
+    SendMessage(LVM_SETITEMCOUNT, first + num_rows, 0);
+    SendMessage(WM_SETREDRAW, FALSE, 0);
+
+    UINT row = 0;
+    for (; row < num_rows; row++)
+    {
+        const LcTextView* row_texts = texts + static_cast<size_t>(row) * num_cols;
+        LVITEM item;
+        item.mask = LVIF_TEXT | LVIF_PARAM;
+        item.iItem = first + row;
+        item.iSubItem = 0;
+        item.pszText = terminated(row_texts[0]);
+        item.lParam = data ? data[row] : 0;
+        const int idx = static_cast<int>(
+            SendMessage(LVM_INSERTITEM, 0, p2lp(&item))
+            );
+        if (idx < 0)
+        {
+            break;
+        }
+        for (UINT col = 1; col < num_cols; col++)
+        {
+            item.iSubItem = col;
+            item.pszText = terminated(row_texts[col]);
+            SendMessage(LVM_SETITEMTEXT, idx, p2lp(&item));
+        }
+        if (m_cache_enabled)
+        {
+            item.iSubItem = 0;
+            item.pszText = terminated(row_texts[0]);
+            CacheInsertRow(idx, item);
+            const UINT cols = static_cast<UINT>(m_text_cache.size());
+            for (UINT col = 1; col < num_cols && col < cols; col++)
+            {
+                const LcTextView& view = row_texts[col];
+                m_text_cache[col][idx] = (
+                    view.len == LcTextView::SZ ?
+                    Yast(view.str) :
+                    Yast(view.str, view.len)
+                    );
+            }
+        }
+    }
+
+    SendMessage(WM_SETREDRAW, TRUE, 0);
+    InvalidateRect();
+    return row;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -180,7 +283,26 @@ bool ListCtrl::SetItemText(int idx, int col_idx, PCTSTR pText)
     LVITEM item;
     item.iSubItem = col_idx;
     item.pszText = const_cast<PTSTR>(pText);
-    return 0 != SendMessage(LVM_SETITEMTEXT, idx, p2lp(&item));
+    if (0 == SendMessage(LVM_SETITEMTEXT, idx, p2lp(&item)))
+    {
+        return false;
+    }
+    if (m_cache_enabled)
+    {
+        if (pText == LPSTR_TEXTCALLBACK)
+        {
+            // can't be cached
+            EnableTextCache(false);
+        }
+        else if (
+            static_cast<UINT>(col_idx) < m_text_cache.size() &&
+            static_cast<UINT>(idx) < m_text_cache[col_idx].size()
+            )
+        {
+            m_text_cache[col_idx][idx] = pText;
+        }
+    }
+    return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -201,22 +323,155 @@ void ListCtrl::SetStyle(UINT style)
 
 Yast ListCtrl::GetItemText(int idx, int col_idx)
 {
-    Yast tmp;
+    if (
+        m_cache_enabled &&
+        static_cast<UINT>(col_idx) < m_text_cache.size() &&
+        static_cast<UINT>(idx) < m_text_cache[col_idx].size()
+        )
+    {
+        return m_text_cache[col_idx][idx];
+    }
+    return FetchItemText(idx, col_idx);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+Yast ListCtrl::FetchItemText(int idx, int col_idx)
+{
+    // The buffer is kept, so usually one LVM_GETITEMTEXT is enough.
+    if (m_text_buf.empty())
+    {
+        m_text_buf.resize(256);
+    }
     LVITEM item;
-    UINT rlen, len = 128;
     item.iSubItem = col_idx;
-    do
+    UINT rlen;
+    for (;;)
     {
-        len *= 2;
-        tmp.clear(len);
-        item.cchTextMax = len + 1;
-        item.pszText = tmp;
+        item.cchTextMax = static_cast<int>(m_text_buf.size());
+        item.pszText = m_text_buf.data();
         rlen = static_cast<UINT>(
             SendMessage(LVM_GETITEMTEXT, idx, p2lp(&item))
             );
+        // a full buffer means the text might have been truncated
+        if (rlen + 1 < m_text_buf.size())
+        {
+            break;
+        }
+        m_text_buf.resize(m_text_buf.size() * 2);
+    }
+    return Yast(m_text_buf.data(), rlen);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+UINT ListCtrl::GetColumnText(int col_idx, YastVector& texts)
+{
+    const UINT cnt = static_cast<UINT>(GetItemCount());
+    if (
+        m_cache_enabled &&
+        static_cast<UINT>(col_idx) < m_text_cache.size() &&
+        m_text_cache[col_idx].size() == cnt
+        )
+    {
+        texts = m_text_cache[col_idx];
+        return cnt;
+    }
+    texts.clear();
+    texts.reserve(cnt);
+    for (UINT i = 0; i < cnt; i++)
+    {
+        texts.push_back(FetchItemText(i, col_idx));
+    }
+    return cnt;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool ListCtrl::EnableTextCache(bool enable)
+{
+    if (!enable)
+    {
+        m_cache_enabled = false;
+        m_text_cache.clear();
+        return false;
+    }
+    if (m_cache_enabled)
+    {
+        return true;
+    }
+
+    // The control re-sorts on LVM_INSERTITEM and LVM_SETITEMTEXT, so the
+    // cached row indices would go stale.
+    if (GetStyle() & (LVS_SORTASCENDING | LVS_SORTDESCENDING))
+    {
+        return false;
+    }
+    int cols = GetColumnCount();
+    if (cols < 1)
+    {
+        cols = 1;
+    }
+    m_text_cache.resize(cols);
+    for (int col = 0; col < cols; col++)
+    {
+        GetColumnText(col, m_text_cache[col]);
+    }
+    m_cache_enabled = true;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ListCtrl::CacheInsertRow(int idx, const LVITEM& item)
+{
+    if (!m_cache_enabled)
+    {
+        return;
+    }
+    const bool has_text = (item.mask & LVIF_TEXT) && item.pszText;
+    if (has_text && item.pszText == LPSTR_TEXTCALLBACK)
+    {
+        EnableTextCache(false);
+        return;
+    }
+    for (size_t col = 0; col < m_text_cache.size(); col++)
+    {
+        YastVector& texts = m_text_cache[col];
+        if (static_cast<size_t>(idx) > texts.size())
+        {
+            // out of sync
+            EnableTextCache(false);
+            return;
+        }
+        texts.insert(
+            texts.begin() + idx,
+            col == 0 && has_text ? Yast(item.pszText) : Yast()
+            );
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ListCtrl::CacheDeleteRow(int idx)
+{
+    for (auto& texts : m_text_cache)
+    {
+        if (static_cast<size_t>(idx) < texts.size())
+        {
+            texts.erase(texts.begin() + idx);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ListCtrl::CacheClear()
+{
+    for (auto& texts : m_text_cache)
+    {
+        texts.clear();
     }
-    while (rlen >= len);
-    return tmp.adapt_to_sz();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
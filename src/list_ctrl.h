@@ -28,20 +28,46 @@
 
 #include "base_wnd.h"
 
-// simple wrapper for LVM_* messages
+// A piece of text that is not necessarily zero terminated. If 'len' is
+// LcTextView::SZ, 'str' is zero terminated and is passed on without copying.
+
+struct LcTextView
+{
+    static const UINT SZ = UINT_MAX;
+
+    PCTSTR str;
+    UINT len;
+};
+
+// Simple wrapper for LVM_* messages.
+//
+// Optionally the texts of all items can be cached in the ListCtrl object, so
+// that GetItemText and GetColumnText don't need to ask the control. The cache
+// is only correct, if all changes to the items are done through this object.
+// It cannot be used for controls with LVS_SORTASCENDING or LVS_SORTDESCENDING
+// (the control re-sorts the items on every insert or text change, which
+// invalidates the cached row indices), EnableTextCache refuses to enable it
+// for those.
 
 class ListCtrl : public BaseWnd
 {
 public:
-    ListCtrl(HWND hWnd = nullptr) : BaseWnd(hWnd)
+    ListCtrl(HWND hWnd = nullptr) : BaseWnd(hWnd), m_cache_enabled(false)
     {
     }
     ListCtrl& operator=(const BaseWnd& src)
     {
+        EnableTextCache(false);
         m_hWnd = src.m_hWnd;
         return *this;
     }
 
+    // Enabling fills the cache with the current texts of the control.
+    // Returns true, if the cache is enabled afterwards.
+    bool     EnableTextCache(bool enable);
+
+    // Retrieves the text of column 'col_idx' for all items.
+    UINT     GetColumnText(int col_idx, YastVector& texts);
 
     int      GetItemCount();
     bool     GetItem(LVITEM& item);
@@ -57,6 +83,16 @@ public:
     int      InsertColumn(int idx, LVCOLUMN& column);
 
     int      InsertItem(LVITEM& item);
+
+    // Appends 'num_rows' rows. 'texts' holds 'num_cols' views per row (row
+    // major), 'data' holds the lParam of every row (may be nullptr). Redraw
+    // is suspended while inserting. Returns the number of inserted rows.
+    UINT     InsertItems(
+                const LcTextView* texts,
+                UINT num_cols,
+                const intptr_t* data,
+                UINT num_rows
+                );
     int      FindItem(LVFINDINFO& info, int start = -1);
 
     void     DeleteAllItems();
@@ -69,4 +105,17 @@ public:
     void     SetImageList(HIMAGELIST img_lst, int type);
     void     SetStyle(UINT style);
 
+protected:
+
+    // Keep the text cache in sync. Derived classes, that send LVM_INSERTITEM,
+    // LVM_DELETEITEM or LVM_DELETEALLITEMS themselves, have to call these.
+    void     CacheInsertRow(int idx, const LVITEM& item);
+    void     CacheDeleteRow(int idx);
+    void     CacheClear();
+
+    Yast     FetchItemText(int idx, int col_idx);
+
+    bool m_cache_enabled;
+    cvector<YastVector> m_text_cache;   // [column][row]
+    cvector<TCHAR> m_text_buf;
 };
@@ -27,6 +27,199 @@
 #include "romato.h"
 #include "list_ctrl_drop_files.h"
 
+////////////////////////////////////////////////////////////////////////////////
+//
+// State of one batched drop operation. It is shared by the pool task working
+// on it and by the progress items posted to the UI thread, each holding a
+// reference.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+struct DropJob
+{
+    DropBatchOptions opts;
+    PathBatch dropped;
+    std::atomic<LONG> refs;
+    std::atomic<UINT64> delivered;
+
+    void add_ref()
+    {
+        refs.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void release()
+    {
+        if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            if (opts.dispatcher)
+            {
+                opts.dispatcher->Release();
+            }
+            delete this;
+        }
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+void progress_item(void* ctx, intptr_t value, bool cancelled)
+{
+    auto job = static_cast<DropJob*>(ctx);
+    if (!cancelled && job->opts.pProgressCallback)
+    {
+        job->opts.pProgressCallback(job->opts.pCtxt, value, false);
+    }
+    job->release();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void done_item(void* ctx, intptr_t value, bool cancelled)
+{
+    auto job = static_cast<DropJob*>(ctx);
+    if (!cancelled && job->opts.pProgressCallback)
+    {
+        job->opts.pProgressCallback(job->opts.pCtxt, value, true);
+    }
+    job->release();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void deliver(DropJob* job, const PathBatch& chunk)
+{
+    if (chunk.empty())
+    {
+        return;
+    }
+    job->opts.pBatchCallback(job->opts.pCtxt, chunk);
+    const UINT64 total = job->delivered.fetch_add(
+        chunk.count(),
+        std::memory_order_relaxed
+        ) + chunk.count();
+
+    if (job->opts.dispatcher)
+    {
+        job->add_ref();
+        job->opts.dispatcher->PostKeyed(
+            p2i<intptr_t>(job),
+            progress_item,
+            job,
+            static_cast<intptr_t>(total)
+            );
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void deliver_walked(void* ctx, const PathBatch& paths, const DirWalkMeta*)
+{
+    deliver(static_cast<DropJob*>(ctx), paths);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Delivers the dropped files and hands the dropped directories to a
+// DirWalker. Runs on a worker thread, which helps walking.
+void run_drop_job(void* ctx)
+{
+    auto job = static_cast<DropJob*>(ctx);
+    const UINT chunk_size = job->opts.chunk_size;
+    PathBatch chunk;
+    cvector<PCWSTR> dirs;
+    for (UINT i = 0; i < job->dropped.count(); i++)
+    {
+        PCWSTR path = job->dropped.path(i);
+        if (job->opts.expand_dirs)
+        {
+            const DWORD attr = GetFileAttributesW(path);
+            if (
+                attr != INVALID_FILE_ATTRIBUTES &&
+                (attr & FILE_ATTRIBUTE_DIRECTORY)
+                )
+            {
+                dirs.push_back(path);
+                continue;
+            }
+        }
+        chunk.add(path, job->dropped.length(i));
+        if (chunk.count() >= chunk_size)
+        {
+            deliver(job, chunk);
+            chunk.clear();
+        }
+    }
+    deliver(job, chunk);
+
+    if (!dirs.empty())
+    {
+        DirWalker walker(*job->opts.pool);
+        walker.set_chunk_size(chunk_size);
+        walker.walk(
+            dirs.data(),
+            static_cast<UINT>(dirs.size()),
+            deliver_walked,
+            job
+            );
+    }
+
+    if (job->opts.dispatcher)
+    {
+        job->add_ref();
+        job->opts.dispatcher->Post(
+            done_item,
+            job,
+            static_cast<intptr_t>(job->delivered.load())
+            );
+    }
+    job->release();
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ListCtrlDropFiles::OnDropFilesBatched(HDROP drop_info)
+{
+    // Long paths may have up to 32767 characters. One buffer for all paths,
+    // one DragQueryFileW per path.
+    const UINT buf_size = 32768;
+    if (m_path_buf.size() < buf_size)
+    {
+        m_path_buf.resize(buf_size);
+    }
+
+    auto job = new DropJob;
+    job->opts = m_batch;
+    job->refs.store(1, std::memory_order_relaxed);
+    job->delivered.store(0, std::memory_order_relaxed);
+    if (job->opts.dispatcher)
+    {
+        job->opts.dispatcher->AddRef();
+    }
+
+    const UINT cnt = DragQueryFileW(drop_info, ~0U, nullptr, 0);
+    job->dropped.reserve(cnt, static_cast<size_t>(cnt) * 64);
+    for (UINT n = 0; n < cnt; n++)
+    {
+        const UINT len = DragQueryFileW(
+            drop_info,
+            n,
+            m_path_buf.data(),
+            buf_size
+            );
+        if (len)
+        {
+            job->dropped.add(m_path_buf.data(), len);
+        }
+    }
+    DragFinish(drop_info);
+
+    m_batch.pool->submit(run_drop_job, job);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 LRESULT ListCtrlDropFiles::WndProc(HWND hWnd, UINT msg, WPARAM wp, LPARAM lp)
@@ -34,6 +227,11 @@ LRESULT ListCtrlDropFiles::WndProc(HWND hWnd, UINT msg, WPARAM wp, LPARAM lp)
     auto self = i2p<ListCtrlDropFiles*>(GetWindowLongPtrW(hWnd, GWLP_USERDATA));
     if (self != nullptr)
     {
+        if (msg == WM_DROPFILES && self->m_batched)
+        {
+            self->OnDropFilesBatched(i2p<HDROP>(wp));
+            return 0;
+        }
         if (msg == WM_DROPFILES && self->m_pCallback)
         {
             auto const drop_info = i2p<HDROP>(wp);
@@ -55,6 +253,26 @@ LRESULT ListCtrlDropFiles::WndProc(HWND hWnd, UINT msg, WPARAM wp, LPARAM lp)
 
 ////////////////////////////////////////////////////////////////////////////////
 
+bool ListCtrlDropFiles::AttachBatched(
+    BaseWnd lst_wnd,
+    const DropBatchOptions& opts
+    )
+{
+    if (!opts.pool || !opts.pBatchCallback || !Attach(lst_wnd))
+    {
+        return false;
+    }
+    m_batch = opts;
+    if (m_batch.chunk_size == 0)
+    {
+        m_batch.chunk_size = 1024;
+    }
+    m_batched = true;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 bool ListCtrlDropFiles::Attach(
     BaseWnd lst_wnd,
     LIST_CTRL_DROP_FILES_CALLBACK pCallback,
@@ -27,11 +27,35 @@
 #pragma once
 
 #include "list_ctrl.h"
+#include "dir_walker.h"
+#include "ui_dispatcher.h"
 
 // a list control that accepts dropping files
 
 using LIST_CTRL_DROP_FILES_CALLBACK = void(*)(void*, const Yast&);
 
+// Batched mode: the dropped paths are handed to a ThreadPool. The batch
+// callback runs on worker threads (possibly several at the same time) and
+// receives at most 'chunk_size' paths per call. If 'expand_dirs' is set,
+// dropped directories are replaced by all files they contain, the
+// directories being scanned in parallel. If 'dispatcher' is given, the
+// progress callback is called on the UI thread with the number of paths
+// delivered so far, and finally with 'done' == true.
+
+using DROP_BATCH_CALLBACK = void(*)(void* ctx, const PathBatch& paths);
+using DROP_PROGRESS_CALLBACK = void(*)(void* ctx, UINT64 count, bool done);
+
+struct DropBatchOptions
+{
+    ThreadPool* pool;
+    UiDispatcher* dispatcher;
+    DROP_BATCH_CALLBACK pBatchCallback;
+    DROP_PROGRESS_CALLBACK pProgressCallback;
+    void* pCtxt;
+    UINT chunk_size;
+    bool expand_dirs;
+};
+
 class ListCtrlDropFiles : public ListCtrl
 {
 public:
@@ -39,7 +63,9 @@ public:
         ListCtrl(nullptr),
         m_original_wnd_proc(nullptr),
         m_pCallback(nullptr),
-        m_pCtxt(nullptr)
+        m_pCtxt(nullptr),
+        m_batched(false),
+        m_batch{}
     {
     }
 
@@ -52,13 +78,21 @@ public:
         void *pCtxt = nullptr
         );
 
+    // 'opts' is copied. 'opts.pool' has to outlive this object.
+    bool AttachBatched(BaseWnd lst_wnd, const DropBatchOptions& opts);
+
 protected:
 
     static LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wp, LPARAM lp);
     void OnDropFiles(HDROP drop_info);
+    void OnDropFilesBatched(HDROP drop_info);
 
     WNDPROC m_original_wnd_proc;
     LIST_CTRL_DROP_FILES_CALLBACK m_pCallback;
     void *m_pCtxt;
 
+    bool m_batched;
+    DropBatchOptions m_batch;
+    cvector<WCHAR> m_path_buf;
+
 };
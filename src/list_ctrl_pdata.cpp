@@ -36,26 +36,37 @@ template <class T> T* ListCtrlPData<T>::GetPrivateItemData(int idx)
     lvi.iItem = idx;
     lvi.lParam = 0;
     SendMessage(LVM_GETITEM, 0, p2lp(&lvi));
-    return i2p<T*>(lvi.lParam);
+    return PrivateDataFromParam(lvi.lParam);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
 template <class T> bool ListCtrlPData<T>::DeleteItem(int idx)
 {
-    delete GetPrivateItemData(idx);
-    return 0 != SendMessage(LVM_DELETEITEM, idx, 0);
+    LVITEM lvi;
+    lvi.mask = LVIF_PARAM;
+    lvi.iItem = idx;
+    lvi.lParam = 0;
+    SendMessage(LVM_GETITEM, 0, p2lp(&lvi));
+    if (lvi.lParam)
+    {
+        m_pool.release(static_cast<UINT>(lvi.lParam - 1));
+    }
+    if (0 == SendMessage(LVM_DELETEITEM, idx, 0))
+    {
+        return false;
+    }
+    CacheDeleteRow(idx);
+    return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
 template <class T> void ListCtrlPData<T>::DeleteAllItems()
 {
-    const int cnt = GetItemCount();
-    for (int i = 0; i < cnt; i++)
-    {
-        delete GetPrivateItemData(i);
-    }
+    // no need to visit every item, the pool knows all of them
+    m_pool.reset();
+    CacheClear();
     SendMessage(LVM_DELETEALLITEMS, 0, 0);
 }
 
@@ -64,7 +75,7 @@ template <class T> void ListCtrlPData<T>::DeleteAllItems()
 template <class T> bool ListCtrlPData<T>::GetItem(LVITEM& item)
 {
     bool res = (0 != SendMessage(LVM_GETITEM, 0, p2lp(&item)));
-    T* pid = i2p<T*>(item.lParam);
+    T* pid = PrivateDataFromParam(item.lParam);
     if (pid)
     {
         item.lParam = pid->user_data;
@@ -76,26 +87,58 @@ template <class T> bool ListCtrlPData<T>::GetItem(LVITEM& item)
 
 template <class T> int ListCtrlPData<T>::InsertItem(LVITEM& item)
 {
+    // Allocate first, so the item can be inserted with its lParam in one go.
+    const UINT id = m_pool.alloc();
+    m_pool.get(id)->user_data = item.lParam;
+
+    LVITEM lvi = item;
+    lvi.mask |= LVIF_PARAM;
+    lvi.lParam = static_cast<LPARAM>(id) + 1;
     const int idx = static_cast<int>(
-        SendMessage(LVM_INSERTITEM, 0, p2i<LPARAM>(&item))
+        SendMessage(LVM_INSERTITEM, 0, p2lp(&lvi))
         );
-    if (idx >= 0)
+    if (idx < 0)
     {
-        T* pid = new T();
-        pid->user_data = item.lParam;
-
-        LVITEM lvi;
-        lvi.iItem = idx;
-        lvi.iSubItem = 0;
-        lvi.mask = LVIF_PARAM;
-        lvi.lParam = p2lp(pid);
-        SendMessage(LVM_SETITEM, 0, p2lp(&lvi));
+        m_pool.release(id);
+    }
+    else
+    {
+        CacheInsertRow(idx, item);
     }
     return idx;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
+template <class T> UINT ListCtrlPData<T>::InsertItems(
+    const LcTextView* texts,
+    UINT num_cols,
+    const intptr_t* data,
+    UINT num_rows
+    )
+{
+    cvector<intptr_t> params(num_rows);
+    for (UINT row = 0; row < num_rows; row++)
+    {
+        const UINT id = m_pool.alloc();
+        m_pool.get(id)->user_data = data ? data[row] : 0;
+        params[row] = static_cast<intptr_t>(id) + 1;
+    }
+    const UINT inserted = ListCtrl::InsertItems(
+        texts,
+        num_cols,
+        params.data(),
+        num_rows
+        );
+    for (UINT row = inserted; row < num_rows; row++)
+    {
+        m_pool.release(static_cast<UINT>(params[row] - 1));
+    }
+    return inserted;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 template <class T> bool ListCtrlPData<T>::SetItemData(int idx, intptr_t data)
 {
     T* pid = GetPrivateItemData(idx);
@@ -32,12 +32,12 @@
 //
 // A list control with private item data.
 // The type of the private data is given by <class T>, which has to be derived
-// from LcpdItemData. For every item a T object is allocated an the heap by
-// calling 'new T()'.
+// from LcpdItemData. The T objects live in a pool owned by the control, the
+// lParam of every list item holds the id of its object (plus 1, so that 0
+// still means 'no data').
 //
-// Since this control creates a heap object for every list item, care must be
-// taken to ensure that all those objects are deleted. See operator= and
-// OnDestroy.
+// All T objects are destroyed by DeleteAllItems and when the control object
+// itself is destroyed. See operator= and OnDestroy.
 //
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -50,6 +50,107 @@ struct LcpdItemData
     }
 };
 
+////////////////////////////////////////////////////////////////////////////////
+//
+// Slab allocator for the private item data. Objects are allocated in chunks
+// and addressed by an index that never changes while the object is alive.
+// Freed ids are reused, and reset() destroys all objects without releasing
+// the chunks.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+template <class T> class LcpdPool
+{
+public:
+
+    static const UINT CHUNK_SIZE = 256;
+
+    LcpdPool() : m_next(0)
+    {
+    }
+
+    ~LcpdPool()
+    {
+        reset();
+        for (auto chunk : m_chunks)
+        {
+            free(chunk);
+        }
+    }
+
+    LcpdPool(const LcpdPool&) = delete;
+    LcpdPool& operator=(const LcpdPool&) = delete;
+
+    UINT alloc()
+    {
+        UINT id;
+        if (!m_free.empty())
+        {
+            id = m_free.back();
+            m_free.pop_back();
+        }
+        else
+        {
+            id = m_next++;
+            if (id / CHUNK_SIZE >= m_chunks.size())
+            {
+                m_chunks.push_back(
+                    static_cast<T*>(malloc(sizeof(T) * CHUNK_SIZE))
+                    );
+                m_live.resize(m_chunks.size() * CHUNK_SIZE, false);
+            }
+        }
+        new (slot(id)) T();
+        m_live[id] = true;
+        return id;
+    }
+
+    void release(UINT id)
+    {
+        if (id < m_next && m_live[id])
+        {
+            slot(id)->~T();
+            m_live[id] = false;
+            m_free.push_back(id);
+        }
+    }
+
+    // nullptr, if 'id' is not alive
+    T* get(UINT id) const
+    {
+        return (id < m_next && m_live[id]) ? slot(id) : nullptr;
+    }
+
+    void reset()
+    {
+        if (!std::is_trivially_destructible<T>::value)
+        {
+            for (UINT id = 0; id < m_next; id++)
+            {
+                if (m_live[id])
+                {
+                    slot(id)->~T();
+                }
+            }
+        }
+        m_live.assign(m_live.size(), false);
+        m_free.clear();
+        m_next = 0;
+    }
+
+protected:
+
+    T* slot(UINT id) const
+    {
+        return m_chunks[id / CHUNK_SIZE] + id % CHUNK_SIZE;
+    }
+
+    cvector<T*> m_chunks;
+    cvector<bool> m_live;
+    cvector<UINT> m_free;
+    UINT m_next;
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 
 template <class T> class ListCtrlPData : public ListCtrl
@@ -67,7 +168,7 @@ public:
     ListCtrlPData& operator=(const BaseWnd& src)
     {
         DeleteAllItems();
-        m_hWnd = src.m_hWnd;
+        ListCtrl::operator=(src);
         return *this;
     }
 
@@ -83,6 +184,12 @@ public:
     void DeleteAllItems();
 
     int InsertItem(LVITEM& item);
+    UINT InsertItems(
+        const LcTextView* texts,
+        UINT num_cols,
+        const intptr_t* data,
+        UINT num_rows
+        );
     bool GetItem(LVITEM& item);
 
     bool SetItemData(int idx, intptr_t data);
@@ -90,6 +197,14 @@ public:
 
 protected:
     T* GetPrivateItemData(int idx);
+
+    // for notifications that carry the lParam of an item
+    T* PrivateDataFromParam(LPARAM lParam)
+    {
+        return lParam ? m_pool.get(static_cast<UINT>(lParam - 1)) : nullptr;
+    }
+
+    LcpdPool<T> m_pool;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -101,26 +216,37 @@ template <class T> T* ListCtrlPData<T>::GetPrivateItemData(int idx)
     lvi.iItem = idx;
     lvi.lParam = 0;
     SendMessage(LVM_GETITEM, 0, p2lp(&lvi));
-    return i2p<T*>(lvi.lParam);
+    return PrivateDataFromParam(lvi.lParam);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
 template <class T> bool ListCtrlPData<T>::DeleteItem(int idx)
 {
-    delete GetPrivateItemData(idx);
-    return 0 != SendMessage(LVM_DELETEITEM, idx, 0);
+    LVITEM lvi;
+    lvi.mask = LVIF_PARAM;
+    lvi.iItem = idx;
+    lvi.lParam = 0;
+    SendMessage(LVM_GETITEM, 0, p2lp(&lvi));
+    if (lvi.lParam)
+    {
+        m_pool.release(static_cast<UINT>(lvi.lParam - 1));
+    }
+    if (0 == SendMessage(LVM_DELETEITEM, idx, 0))
+    {
+        return false;
+    }
+    CacheDeleteRow(idx);
+    return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
 template <class T> void ListCtrlPData<T>::DeleteAllItems()
 {
-    const int cnt = GetItemCount();
-    for (int i = 0; i < cnt; i++)
-    {
-        delete GetPrivateItemData(i);
-    }
+    // no need to visit every item, the pool knows all of them
+    m_pool.reset();
+    CacheClear();
     SendMessage(LVM_DELETEALLITEMS, 0, 0);
 }
 
@@ -129,7 +255,7 @@ template <class T> void ListCtrlPData<T>::DeleteAllItems()
 template <class T> bool ListCtrlPData<T>::GetItem(LVITEM& item)
 {
     bool res = (0 != SendMessage(LVM_GETITEM, 0, p2lp(&item)));
-    T* pid = i2p<T*>(item.lParam);
+    T* pid = PrivateDataFromParam(item.lParam);
     if (pid)
     {
         item.lParam = pid->user_data;
@@ -141,26 +267,58 @@ template <class T> bool ListCtrlPData<T>::GetItem(LVITEM& item)
 
 template <class T> int ListCtrlPData<T>::InsertItem(LVITEM& item)
 {
+    // Allocate first, so the item can be inserted with its lParam in one go.
+    const UINT id = m_pool.alloc();
+    m_pool.get(id)->user_data = item.lParam;
+
+    LVITEM lvi = item;
+    lvi.mask |= LVIF_PARAM;
+    lvi.lParam = static_cast<LPARAM>(id) + 1;
     const int idx = static_cast<int>(
-        SendMessage(LVM_INSERTITEM, 0, p2i<LPARAM>(&item))
+        SendMessage(LVM_INSERTITEM, 0, p2lp(&lvi))
         );
-    if (idx >= 0)
+    if (idx < 0)
     {
-        T* pid = new T();
-        pid->user_data = item.lParam;
-
-        LVITEM lvi;
-        lvi.iItem = idx;
-        lvi.iSubItem = 0;
-        lvi.mask = LVIF_PARAM;
-        lvi.lParam = p2lp(pid);
-        SendMessage(LVM_SETITEM, 0, p2lp(&lvi));
+        m_pool.release(id);
+    }
+    else
+    {
+        CacheInsertRow(idx, item);
     }
     return idx;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
+template <class T> UINT ListCtrlPData<T>::InsertItems(
+    const LcTextView* texts,
+    UINT num_cols,
+    const intptr_t* data,
+    UINT num_rows
+    )
+{
+    cvector<intptr_t> params(num_rows);
+    for (UINT row = 0; row < num_rows; row++)
+    {
+        const UINT id = m_pool.alloc();
+        m_pool.get(id)->user_data = data ? data[row] : 0;
+        params[row] = static_cast<intptr_t>(id) + 1;
+    }
+    const UINT inserted = ListCtrl::InsertItems(
+        texts,
+        num_cols,
+        params.data(),
+        num_rows
+        );
+    for (UINT row = inserted; row < num_rows; row++)
+    {
+        m_pool.release(static_cast<UINT>(params[row] - 1));
+    }
+    return inserted;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 template <class T> bool ListCtrlPData<T>::SetItemData(int idx, intptr_t data)
 {
     T* pid = GetPrivateItemData(idx);
@@ -26,6 +26,7 @@
 
 #include "romato.h"
 #include "list_ctrl_progress.h"
+#include <algorithm>
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -71,14 +72,178 @@ void ListCtrlProgress::SetProgress(int idx, int col_idx, int percent)
 
     if (changed)
     {
-        CRect rect(GetSubItemRect(idx, col_idx));
-        InvalidateRect(&rect, true);
-        Update();
+        MarkDirty(idx);
     }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
+ListCtrlProgress::~ListCtrlProgress()
+{
+    StopFrameTimer();
+    delete[] m_slots;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ListCtrlProgress::ReserveProgressSlots(UINT count)
+{
+    delete[] m_slots;
+    m_slots = nullptr;
+    m_num_slots = 0;
+    if (count)
+    {
+        m_slots = new std::atomic<uint32_t>[count]();
+        m_num_slots = count;
+
+        // Workers can't start the timer, so it has to run as long as there
+        // are slots.
+        StartFrameTimer();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ListCtrlProgress::MarkDirty(int idx)
+{
+    m_dirty.push_back(idx);
+    StartFrameTimer();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ListCtrlProgress::StartFrameTimer()
+{
+    if (!m_timer_active && m_hWnd)
+    {
+        m_timer_active = 0 != ::SetTimer(
+            m_hWnd,
+            p2i<UINT_PTR>(this),
+            FRAME_MS,
+            TimerProc
+            );
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ListCtrlProgress::StopFrameTimer()
+{
+    if (m_timer_active)
+    {
+        ::KillTimer(m_hWnd, p2i<UINT_PTR>(this));
+        m_timer_active = false;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void CALLBACK ListCtrlProgress::TimerProc(
+    HWND hWnd,
+    UINT msg,
+    UINT_PTR id,
+    DWORD ms
+    )
+{
+    UNUSED(hWnd);
+    UNUSED(msg);
+    UNUSED(ms);
+    i2p<ListCtrlProgress*>(id)->OnFrame();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ListCtrlProgress::OnFrame()
+{
+    FlushRepaint();
+    if (m_num_slots == 0)
+    {
+        StopFrameTimer();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ListCtrlProgress::PollSlots()
+{
+    if (!m_slots_pending.exchange(false, std::memory_order_acquire))
+    {
+        return;
+    }
+    const UINT cnt = m_num_slots;
+    for (UINT i = 0; i < cnt; i++)
+    {
+        if (m_slots[i].load(std::memory_order_relaxed) == 0)
+        {
+            continue;
+        }
+        const uint32_t v = m_slots[i].exchange(0, std::memory_order_relaxed);
+        if (v & SLOT_PENDING)
+        {
+            SetProgress(i, (v >> 8) & 0x7fff, v & 0xff);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ListCtrlProgress::FlushRepaint()
+{
+    PollSlots();
+    if (m_dirty.empty())
+    {
+        return;
+    }
+
+    // Only rows that are (partially) visible need to be painted.
+    const int top = static_cast<int>(SendMessage(LVM_GETTOPINDEX, 0, 0));
+    const int per_page = static_cast<int>(
+        SendMessage(LVM_GETCOUNTPERPAGE, 0, 0)
+        );
+    lcp_merge_rows(m_dirty, top, top + per_page, m_runs);
+
+    for (const auto& run : m_runs)
+    {
+        CRect rect(GetItemRect(run.first));
+        if (run.last != run.first)
+        {
+            rect.bottom = GetItemRect(run.last).bottom;
+        }
+        InvalidateRect(&rect, false);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void lcp_merge_rows(
+    cvector<int>& rows,
+    int first_visible,
+    int last_visible,
+    cvector<LcpRowRun>& runs
+    )
+{
+    runs.clear();
+    std::sort(rows.begin(), rows.end());
+    for (const int row : rows)
+    {
+        if (row < first_visible || row > last_visible)
+        {
+            continue;
+        }
+        if (!runs.empty() && row <= runs.back().last + 1)
+        {
+            runs.back().last = row;
+        }
+        else
+        {
+            runs.push_back(LcpRowRun{row, row});
+        }
+    }
+    rows.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 LRESULT ListCtrlProgress::OnCustomDraw(NMLVCUSTOMDRAW* pLVCD)
 {
     // First we have to check the draw stage. If it's the control's prepaint
@@ -106,78 +271,17 @@ LRESULT ListCtrlProgress::OnCustomDraw(NMLVCUSTOMDRAW* pLVCD)
     int idx = static_cast<int>(pLVCD->nmcd.dwItemSpec);
     int col = pLVCD->iSubItem;
 
-    auto pid = i2p<ItemProgress*>(pLVCD->nmcd.lItemlParam);
+    auto pid = PrivateDataFromParam(pLVCD->nmcd.lItemlParam);
     if (!pid || pid->PercentColumn != col || !pid->ShowProgress)
     {
         return CDRF_DODEFAULT;
     }
 
     CRect rect(GetSubItemRect(idx, col));
-    HDC hdc = pLVCD->nmcd.hdc;
-
     rect.bottom -= 1;
     rect.left += 1;     // leave margin in case row is highlighted
+    m_renderer.Draw(pLVCD->nmcd.hdc, rect, pid->ProgressPercent);
 
-    // fill interior with light gray
-    FillSolidRect(hdc, &rect, RGB(224,224,224));
-
-    // draw border
-    RECT tmp;
-    tmp.left = rect.left;
-    tmp.top = rect.top;
-    tmp.right = rect.right - 1;
-    tmp.bottom = rect.top + 1;
-    FillSolidRect(hdc, &tmp, RGB(0,0,0));
-    tmp.right = rect.left + 1;
-    tmp.bottom = rect.bottom - 1;
-    FillSolidRect(hdc, &tmp, RGB(0,0,0));
-    tmp.left = rect.right;
-    tmp.right = rect.right - 1;
-    tmp.bottom = rect.bottom;
-    FillSolidRect(hdc, &tmp, GetSysColor(COLOR_BTNSHADOW));
-    tmp.left = rect.left;
-    tmp.top = rect.bottom;
-    tmp.right = rect.right;
-    tmp.bottom = rect.bottom - 1;
-    FillSolidRect(hdc, &tmp, GetSysColor(COLOR_BTNSHADOW));
-
-    const int percent = pid->ProgressPercent;
-    if (percent > 0)
-    {
-        TCHAR txt[8];
-        SZ_PRINTF(txt, TEXT("%d%%"), percent);
-        RECT left, right, trc;
-        left.left = rect.left + 1;
-        left.top = rect.top + 1;
-        left.right = rect.right;
-        left.bottom = rect.bottom - 1;
-        right.top = left.top;
-        right.right = left.right;
-        right.bottom = left.bottom;
-        int width = (left.right - left.left) * percent / 100;
-        left.right = left.left + width - 1;
-        right.left = left.right;
-        FillSolidRect(hdc, &left, GetSysColor(COLOR_HIGHLIGHT));
-        SetBkMode(hdc, TRANSPARENT);
-        trc.left = rect.left + 1;
-        trc.top = rect.top + 1;
-        trc.right = rect.right - 1;
-        trc.bottom = rect.bottom - 1;
-
-        HRGN rgn = CreateRectRgn(left.left, left.top, left.right, left.bottom);
-        SelectClipRgn(hdc, rgn);
-        SetTextColor(hdc, GetSysColor(COLOR_HIGHLIGHTTEXT));
-        DrawText(hdc, txt, -1, &trc, DT_CENTER | DT_VCENTER | DT_SINGLELINE);
-        DeleteObject(rgn);
-
-        rgn = CreateRectRgn(right.left, right.top, right.right, right.bottom);
-        SelectClipRgn(hdc, rgn);
-        SetTextColor(hdc, GetSysColor(COLOR_WINDOWTEXT));
-        DrawText(hdc, txt, -1, &trc, DT_CENTER | DT_VCENTER | DT_SINGLELINE);
-
-        DeleteObject(rgn);
-        SelectClipRgn(hdc, nullptr);
-    }
     // We've painted everything.
     return CDRF_SKIPDEFAULT;
 }
@@ -27,6 +27,7 @@
 #pragma once
 
 #include "list_ctrl_pdata.h"
+#include "progress_renderer.h"
 
 struct ItemProgress : public LcpdItemData
 {
@@ -43,18 +44,69 @@ struct ItemProgress : public LcpdItemData
 };
 
 
+// A run of consecutive dirty rows [first, last].
+
+struct LcpRowRun
+{
+    int first;
+    int last;
+};
+
+// Sorts 'rows', drops duplicates and rows outside [first_visible,
+// last_visible] and merges the rest into runs of consecutive rows. 'rows' is
+// cleared.
+void lcp_merge_rows(
+    cvector<int>& rows,
+    int first_visible,
+    int last_visible,
+    cvector<LcpRowRun>& runs
+    );
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Changes of the progress are not painted immediately. The affected rows are
+// collected and invalidated at most once per frame (FRAME_MS), adjacent rows
+// with a single rectangle.
+//
+// Worker threads can report progress without going through the UI thread's
+// message queue: after ReserveProgressSlots(n) was called, PublishProgress
+// may be called from any thread for rows 0 .. n-1. The published values are
+// picked up once per frame. Rows must not be inserted or deleted while slots
+// are reserved, since slots are addressed by row index.
+//
+////////////////////////////////////////////////////////////////////////////////
+
 class ListCtrlProgress : public ListCtrlPData<ItemProgress>
 {
 public:
-    ListCtrlProgress(HWND hWnd = nullptr) : ListCtrlPData(hWnd)
+
+    static const UINT FRAME_MS = 16;
+
+    ListCtrlProgress(HWND hWnd = nullptr) :
+        ListCtrlPData(hWnd),
+        m_timer_active(false),
+        m_slots(nullptr),
+        m_num_slots(0),
+        m_slots_pending(false)
     {
     }
+    ~ListCtrlProgress();
+
     ListCtrlProgress& operator=(const BaseWnd& src)
     {
+        StopFrameTimer();
         ListCtrlPData::operator=(src);
         return *this;
     }
 
+    // handler for WM_DESTROY
+    void OnDestroy()
+    {
+        StopFrameTimer();
+        m_renderer.Reset();
+        ListCtrlPData::OnDestroy();
+    }
+
     // Parent can feed WM_NOTIFY messages from this control into
     // this method. Doing so is mandatory, if this control is meant to
     // paint progress bars.
@@ -62,7 +114,55 @@ public:
 
     void SetProgress(int idx, int col_idx, int percent = 0);
 
+    // UI thread only. Passing 0 releases the slots.
+    void ReserveProgressSlots(UINT count);
+
+    // Any thread. Only the latest value per row is kept.
+    void PublishProgress(UINT idx, int col_idx, int percent)
+    {
+        if (idx < m_num_slots)
+        {
+            if (percent < 0)
+            {
+                percent = 0;
+            }
+            else if (percent > 100)
+            {
+                percent = 100;
+            }
+            const uint32_t packed = (
+                SLOT_PENDING |
+                (static_cast<uint32_t>(col_idx & 0x7fff) << 8) |
+                static_cast<uint32_t>(percent)
+                );
+            m_slots[idx].store(packed, std::memory_order_relaxed);
+            m_slots_pending.store(true, std::memory_order_release);
+        }
+    }
+
+    // Paint pending changes now instead of waiting for the next frame.
+    void FlushRepaint();
+
 protected:
 
+    static const uint32_t SLOT_PENDING = 0x80000000;
+
+    static void CALLBACK TimerProc(HWND hWnd, UINT msg, UINT_PTR id, DWORD ms);
+
     LRESULT OnCustomDraw(NMLVCUSTOMDRAW* pLVCD);
+    void MarkDirty(int idx);
+    void StartFrameTimer();
+    void StopFrameTimer();
+    void OnFrame();
+    void PollSlots();
+
+    ProgressRenderer m_renderer;
+
+    cvector<int> m_dirty;
+    cvector<LcpRowRun> m_runs;
+    bool m_timer_active;
+
+    std::atomic<uint32_t>* m_slots;
+    UINT m_num_slots;
+    std::atomic<bool> m_slots_pending;
 };
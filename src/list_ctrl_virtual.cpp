@@ -0,0 +1,593 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// This file is part of the romato library.
+//
+// Copyright 2013-2026 Rocco Matano
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "romato.h"
+#include "list_ctrl_virtual.h"
+#include <algorithm>
+
+////////////////////////////////////////////////////////////////////////////////
+
+LcvModel::LcvModel(UINT num_columns) :
+    m_garbage(0),
+    m_filter_func(nullptr),
+    m_filter_ctx(nullptr),
+    m_sort{SortSpec::NONE, 0, nullptr, nullptr, true},
+    m_cache_first(0),
+    m_cache_count(0)
+{
+    set_column_count(num_columns);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void LcvModel::set_column_count(UINT num_columns)
+{
+    m_columns.clear();
+    m_columns.resize(num_columns);
+    m_cb_columns.clear();
+    m_sort.kind = SortSpec::NONE;
+    clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void LcvModel::set_column_callback(UINT col, LCV_TEXT_FUNC func, void* ctx)
+{
+    if (col >= column_count())
+    {
+        RaiseException(E_INVALIDARG);
+    }
+    Column& column = m_columns[col];
+    column.func = func;
+    column.ctx = ctx;
+    column.cells.assign(row_count(), Cell{0, 0});
+
+    m_cb_columns.clear();
+    for (UINT i = 0; i < column_count(); i++)
+    {
+        if (m_columns[i].func)
+        {
+            m_cb_columns.push_back(i);
+        }
+    }
+    invalidate_cache();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void LcvModel::reserve(UINT rows, size_t chars)
+{
+    for (auto& column : m_columns)
+    {
+        column.cells.reserve(rows);
+    }
+    m_data.reserve(rows);
+    m_view.reserve(rows);
+    m_arena.reserve(chars);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void LcvModel::clear()
+{
+    // Offset 0 is a shared empty string.
+    m_arena.assign(1, 0);
+    m_garbage = 0;
+    for (auto& column : m_columns)
+    {
+        column.cells.clear();
+    }
+    m_data.clear();
+    m_view.clear();
+    m_inverse.clear();
+    invalidate_cache();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+LcvModel::Cell LcvModel::store(PCWSTR text, UINT len)
+{
+    if (len == 0)
+    {
+        return Cell{0, 0};
+    }
+    const size_t offset = m_arena.size();
+    if (offset + len + 1 > UINT_MAX)
+    {
+        RaiseException(E_OUTOFMEMORY);
+    }
+    m_arena.insert(m_arena.end(), text, text + len);
+    m_arena.push_back(0);
+    return Cell{static_cast<UINT>(offset), len};
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+UINT LcvModel::add_row(const PCWSTR* texts, intptr_t data)
+{
+    const UINT num_columns = column_count();
+    UINT lengths[64];
+    cvector<UINT> more;
+    UINT* plen = lengths;
+    if (num_columns > ARRAY_SIZE(lengths))
+    {
+        more.resize(num_columns);
+        plen = more.data();
+    }
+    for (UINT i = 0; i < num_columns; i++)
+    {
+        plen[i] = texts[i] ? sz_lenW(texts[i]) : 0;
+    }
+    return add_row(texts, plen, data);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+UINT LcvModel::add_row(const PCWSTR* texts, const UINT* lengths, intptr_t data)
+{
+    const UINT row = row_count();
+    for (UINT i = 0; i < column_count(); i++)
+    {
+        Column& column = m_columns[i];
+        if (column.func || texts[i] == nullptr)
+        {
+            column.cells.push_back(Cell{0, 0});
+        }
+        else
+        {
+            column.cells.push_back(store(texts[i], lengths[i]));
+        }
+    }
+    m_data.push_back(data);
+
+    if (!m_filter_func || m_filter_func(m_filter_ctx, *this, row))
+    {
+        m_view.push_back(row);
+        m_inverse.clear();
+    }
+    return row;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void LcvModel::set_text(UINT row, UINT col, PCWSTR text, UINT len)
+{
+    if (col >= column_count() || row >= row_count() || m_columns[col].func)
+    {
+        RaiseException(E_INVALIDARG);
+    }
+    Cell& cell = m_columns[col].cells[row];
+    if (cell.length)
+    {
+        m_garbage += cell.length + 1;
+    }
+    cell = store(text, len);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+PCWSTR LcvModel::text(UINT row, UINT col, UINT* len) const
+{
+    const Column& column = m_columns[col];
+    if (column.func)
+    {
+        m_scratch.clear();
+        column.func(column.ctx, row, col, m_scratch);
+        if (len)
+        {
+            *len = m_scratch.length();
+        }
+        return m_scratch;
+    }
+    const Cell& cell = column.cells[row];
+    if (len)
+    {
+        *len = cell.length;
+    }
+    return m_arena.data() + cell.offset;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+PCWSTR LcvModel::view_text(UINT idx, UINT col, UINT* len) const
+{
+    if (m_columns[col].func && idx - m_cache_first < m_cache_count)
+    {
+        const UINT num_cb = static_cast<UINT>(m_cb_columns.size());
+        for (UINT j = 0; j < num_cb; j++)
+        {
+            if (m_cb_columns[j] == col)
+            {
+                const Yast& cached = m_cache[(idx - m_cache_first) * num_cb + j];
+                if (len)
+                {
+                    *len = cached.length();
+                }
+                return cached;
+            }
+        }
+    }
+    return text(m_view[idx], col, len);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void LcvModel::compact()
+{
+    if (m_garbage == 0)
+    {
+        return;
+    }
+    cvector<WCHAR> old;
+    old.swap(m_arena);
+    m_arena.reserve(old.size() - m_garbage);
+    m_arena.push_back(0);
+    for (auto& column : m_columns)
+    {
+        for (auto& cell : column.cells)
+        {
+            cell = store(old.data() + cell.offset, cell.length);
+        }
+    }
+    m_garbage = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int LcvModel::row_to_view(UINT row) const
+{
+    if (m_inverse.size() != row_count())
+    {
+        m_inverse.assign(row_count(), -1);
+        for (UINT i = 0; i < view_count(); i++)
+        {
+            m_inverse[m_view[i]] = static_cast<int>(i);
+        }
+    }
+    return row < row_count() ? m_inverse[row] : -1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void LcvModel::sort(UINT col, bool ascending)
+{
+    if (col >= column_count())
+    {
+        RaiseException(E_INVALIDARG);
+    }
+    m_sort = SortSpec{SortSpec::COLUMN, col, nullptr, nullptr, ascending};
+    apply_sort();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void LcvModel::sort(LCV_COMPARE_FUNC func, void* ctx, bool ascending)
+{
+    m_sort = SortSpec{SortSpec::FUNC, 0, func, ctx, ascending};
+    apply_sort();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void LcvModel::filter(LCV_FILTER_FUNC func, void* ctx)
+{
+    m_filter_func = func;
+    m_filter_ctx = ctx;
+    rebuild_view();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void LcvModel::rebuild_view()
+{
+    m_view.clear();
+    for (UINT row = 0; row < row_count(); row++)
+    {
+        if (!m_filter_func || m_filter_func(m_filter_ctx, *this, row))
+        {
+            m_view.push_back(row);
+        }
+    }
+    apply_sort();
+    m_inverse.clear();
+    invalidate_cache();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void LcvModel::apply_sort()
+{
+    m_inverse.clear();
+    invalidate_cache();
+
+    const bool asc = m_sort.ascending;
+    if (m_sort.kind == SortSpec::FUNC)
+    {
+        auto func = m_sort.func;
+        auto ctx = m_sort.ctx;
+        std::stable_sort(
+            m_view.begin(),
+            m_view.end(),
+            [&](UINT a, UINT b)
+            {
+                const int res = func(ctx, *this, a, b);
+                return asc ? res < 0 : res > 0;
+            }
+            );
+        return;
+    }
+    if (m_sort.kind != SortSpec::COLUMN)
+    {
+        return;
+    }
+
+    // Comparing with CompareStringW is far too slow for millions of rows.
+    // So the sort keys are computed once per row and compared bytewise.
+    struct Key
+    {
+        size_t offset;
+        UINT length;
+    };
+    const UINT col = m_sort.col;
+    const UINT cnt = view_count();
+    cvector<Key> keys(row_count());
+    cvector<BYTE> key_arena;
+    key_arena.reserve(static_cast<size_t>(cnt) * 16);
+    for (UINT i = 0; i < cnt; i++)
+    {
+        const UINT row = m_view[i];
+        UINT len;
+        PCWSTR str = text(row, col, &len);
+        const size_t offset = key_arena.size();
+        int klen = 0;
+        if (len)
+        {
+            const int need = LCMapStringW(
+                LOCALE_USER_DEFAULT,
+                LCMAP_SORTKEY | SORT_STRINGSORT,
+                str,
+                len,
+                nullptr,
+                0
+                );
+            key_arena.resize(offset + need);
+            klen = LCMapStringW(
+                LOCALE_USER_DEFAULT,
+                LCMAP_SORTKEY | SORT_STRINGSORT,
+                str,
+                len,
+                p2p<PWSTR>(key_arena.data() + offset),
+                need
+                );
+        }
+        keys[row] = Key{offset, static_cast<UINT>(klen)};
+    }
+
+    const BYTE* base = key_arena.data();
+    std::stable_sort(
+        m_view.begin(),
+        m_view.end(),
+        [&](UINT a, UINT b)
+        {
+            const Key& ka = keys[a];
+            const Key& kb = keys[b];
+            const UINT len = ka.length < kb.length ? ka.length : kb.length;
+            int res = memcmp(base + ka.offset, base + kb.offset, len);
+            if (res == 0)
+            {
+                res = static_cast<int>(ka.length) - static_cast<int>(kb.length);
+            }
+            return asc ? res < 0 : res > 0;
+        }
+        );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void LcvModel::prefetch(UINT first, UINT last)
+{
+    if (m_cb_columns.empty() || first >= view_count())
+    {
+        return;
+    }
+    if (last >= view_count())
+    {
+        last = view_count() - 1;
+    }
+    if (
+        m_cache_count &&
+        first >= m_cache_first &&
+        last < m_cache_first + m_cache_count
+        )
+    {
+        return;
+    }
+
+    const UINT num_cb = static_cast<UINT>(m_cb_columns.size());
+    m_cache_first = first;
+    m_cache_count = last - first + 1;
+    m_cache.resize(static_cast<size_t>(m_cache_count) * num_cb);
+    for (UINT i = 0; i < m_cache_count; i++)
+    {
+        const UINT row = m_view[first + i];
+        for (UINT j = 0; j < num_cb; j++)
+        {
+            const UINT col = m_cb_columns[j];
+            Yast& text = m_cache[static_cast<size_t>(i) * num_cb + j];
+            text.clear();
+            m_columns[col].func(m_columns[col].ctx, row, col, text);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+LRESULT ListCtrlVirtual::HandleReflectedNotify(NMHDR* pNMHDR)
+{
+    if (pNMHDR->hwndFrom != m_hWnd)
+    {
+        return 0;
+    }
+    switch (pNMHDR->code)
+    {
+        case LVN_GETDISPINFOW:
+            OnGetDispInfo(p2p<NMLVDISPINFOW*>(pNMHDR));
+            break;
+
+        case LVN_ODCACHEHINT:
+        {
+            auto pCH = p2p<NMLVCACHEHINT*>(pNMHDR);
+            m_model.prefetch(pCH->iFrom, pCH->iTo);
+            break;
+        }
+
+        case LVN_ODFINDITEMW:
+            return OnFindItem(p2p<NMLVFINDITEMW*>(pNMHDR));
+    }
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ListCtrlVirtual::OnGetDispInfo(NMLVDISPINFOW* pDI)
+{
+    LVITEMW& item = pDI->item;
+    const UINT idx = static_cast<UINT>(item.iItem);
+    const UINT col = static_cast<UINT>(item.iSubItem);
+    if (
+        !(item.mask & LVIF_TEXT) ||
+        idx >= m_model.view_count() ||
+        col >= m_model.column_count()
+        )
+    {
+        return;
+    }
+    // The control allows to point to our own buffer instead of copying.
+    item.pszText = const_cast<PWSTR>(m_model.view_text(idx, col));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int ListCtrlVirtual::OnFindItem(NMLVFINDITEMW* pFI)
+{
+    const LVFINDINFOW& info = pFI->lvfi;
+    const UINT cnt = m_model.view_count();
+    if (!(info.flags & (LVFI_STRING | LVFI_PARTIAL)) || !info.psz || !cnt)
+    {
+        return -1;
+    }
+    const UINT plen = sz_lenW(info.psz);
+    const bool partial = (info.flags & LVFI_PARTIAL) != 0;
+    UINT start = pFI->iStart < 0 ? 0 : static_cast<UINT>(pFI->iStart);
+    if (start >= cnt)
+    {
+        start = 0;
+    }
+    for (UINT n = 0; n < cnt; n++)
+    {
+        const UINT idx = (start + n) % cnt;
+        if (idx < start && !(info.flags & LVFI_WRAP))
+        {
+            break;
+        }
+        UINT len;
+        PCWSTR str = m_model.view_text(idx, 0, &len);
+        if (len < plen || (!partial && len != plen))
+        {
+            continue;
+        }
+        const int cmp = CompareStringW(
+            LOCALE_USER_DEFAULT,
+            NORM_IGNORECASE,
+            str,
+            plen,
+            info.psz,
+            plen
+            );
+        if (cmp == CSTR_EQUAL)
+        {
+            return static_cast<int>(idx);
+        }
+    }
+    return -1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ListCtrlVirtual::Refresh()
+{
+    m_model.invalidate_cache();
+    SendMessage(LVM_SETITEMCOUNT, m_model.view_count(), LVSICF_NOSCROLL);
+    InvalidateRect();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ListCtrlVirtual::SortBy(int col_idx, bool ascending)
+{
+    m_model.sort(static_cast<UINT>(col_idx), ascending);
+    Refresh();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ListCtrlVirtual::DeleteAllItems()
+{
+    m_model.clear();
+    Refresh();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+intptr_t ListCtrlVirtual::GetItemData(int idx)
+{
+    if (idx < 0 || static_cast<UINT>(idx) >= m_model.view_count())
+    {
+        return 0;
+    }
+    return m_model.data(m_model.view_to_row(idx));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+Yast ListCtrlVirtual::GetItemText(int idx, int col_idx)
+{
+    if (
+        idx < 0 ||
+        static_cast<UINT>(idx) >= m_model.view_count() ||
+        col_idx < 0 ||
+        static_cast<UINT>(col_idx) >= m_model.column_count()
+        )
+    {
+        return Yast();
+    }
+    UINT len;
+    PCWSTR str = m_model.view_text(idx, col_idx, &len);
+    return Yast(str, len);
+}
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,274 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// This file is part of the romato library.
+//
+// Copyright 2013-2026 Rocco Matano
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "list_ctrl.h"
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// A list control with LVS_OWNERDATA style (the control has to be created with
+// that style, it can't be changed afterwards).
+//
+// The rows are not stored in the control but in an LcvModel. The model keeps
+// the text of all columns in one packed character arena (no allocation per
+// row or cell) and a view index, that maps list indices to model rows, so
+// sorting and filtering never touch the strings themselves.
+//
+// Columns can also be computed by a callback. Those are fetched for a whole
+// range of rows, when the control sends LVN_ODCACHEHINT, and kept in a cache
+// window until the next hint.
+//
+// The parent has to feed WM_NOTIFY messages from this control into
+// HandleReflectedNotify. After the model has been changed, Refresh() must be
+// called.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+class LcvModel;
+
+// Computes the text of a callback column.
+using LCV_TEXT_FUNC = void(*)(void* ctx, UINT row, UINT col, Yast& text);
+
+// Returns true, if a row should be visible.
+using LCV_FILTER_FUNC = bool(*)(void* ctx, const LcvModel& model, UINT row);
+
+// Returns <0, 0 or >0 like strcmp.
+using LCV_COMPARE_FUNC = int(*)(void* ctx, const LcvModel& model, UINT a, UINT b);
+
+////////////////////////////////////////////////////////////////////////////////
+
+class LcvModel
+{
+public:
+
+    LcvModel(UINT num_columns = 1);
+
+    LcvModel(const LcvModel&) = delete;
+    LcvModel& operator=(const LcvModel&) = delete;
+
+    // Deletes all rows.
+    void set_column_count(UINT num_columns);
+
+    // Column 'col' is not stored, but computed by 'func'.
+    void set_column_callback(UINT col, LCV_TEXT_FUNC func, void* ctx);
+
+    UINT column_count() const
+    {
+        return static_cast<UINT>(m_columns.size());
+    }
+
+    UINT row_count() const
+    {
+        return static_cast<UINT>(m_data.size());
+    }
+
+    void reserve(UINT rows, size_t chars);
+    void clear();
+
+    // 'texts' has column_count() entries, nullptr means empty. Entries for
+    // callback columns are ignored. Returns the index of the new row. The row
+    // is appended to the view only if it passes the current filter, but the
+    // view is NOT resorted.
+    UINT add_row(const PCWSTR* texts, intptr_t data = 0);
+    UINT add_row(const PCWSTR* texts, const UINT* lengths, intptr_t data);
+
+    // The previous text stays in the arena until compact() is called.
+    void set_text(UINT row, UINT col, PCWSTR text, UINT len);
+
+    void set_text(UINT row, UINT col, PCWSTR text)
+    {
+        set_text(row, col, text, sz_lenW(text));
+    }
+
+    // The result is zero terminated and valid until the model is modified.
+    // For callback columns it is valid until the next call of text().
+    PCWSTR text(UINT row, UINT col, UINT* len = nullptr) const;
+
+    // Same as text(view_to_row(idx), col, len), but callback columns are
+    // served from the cache window, if possible.
+    PCWSTR view_text(UINT idx, UINT col, UINT* len = nullptr) const;
+
+    intptr_t data(UINT row) const
+    {
+        return m_data[row];
+    }
+
+    void set_data(UINT row, intptr_t data)
+    {
+        m_data[row] = data;
+    }
+
+    // Drop text that has been replaced by set_text.
+    void compact();
+
+    ////////////////////////////////////////////////////////////////////////////
+    // view
+
+    UINT view_count() const
+    {
+        return static_cast<UINT>(m_view.size());
+    }
+
+    UINT view_to_row(UINT idx) const
+    {
+        return m_view[idx];
+    }
+
+    // -1 if 'row' is filtered out
+    int row_to_view(UINT row) const;
+
+    // Stable sort by the text of a stored column.
+    void sort(UINT col, bool ascending);
+    void sort(LCV_COMPARE_FUNC func, void* ctx, bool ascending);
+
+    // nullptr shows all rows. The current sort order is reapplied.
+    void filter(LCV_FILTER_FUNC func, void* ctx);
+
+    ////////////////////////////////////////////////////////////////////////////
+    // cache window for callback columns
+
+    // 'first' and 'last' are view indices (inclusive).
+    void prefetch(UINT first, UINT last);
+
+    void invalidate_cache()
+    {
+        m_cache_count = 0;
+    }
+
+protected:
+
+    struct Cell
+    {
+        UINT offset;
+        UINT length;
+    };
+
+    struct Column
+    {
+        cvector<Cell> cells;
+        LCV_TEXT_FUNC func;
+        void* ctx;
+    };
+
+    struct SortSpec
+    {
+        enum {NONE, COLUMN, FUNC} kind;
+        UINT col;
+        LCV_COMPARE_FUNC func;
+        void* ctx;
+        bool ascending;
+    };
+
+    Cell store(PCWSTR text, UINT len);
+    void rebuild_view();
+    void apply_sort();
+
+    cvector<Column> m_columns;
+    cvector<UINT> m_cb_columns;         // indices of the callback columns
+    cvector<WCHAR> m_arena;
+    size_t m_garbage;
+    cvector<intptr_t> m_data;
+
+    cvector<UINT> m_view;
+    mutable cvector<int> m_inverse;     // built on demand by row_to_view
+    LCV_FILTER_FUNC m_filter_func;
+    void* m_filter_ctx;
+    SortSpec m_sort;
+
+    // texts of all callback columns for the view indices
+    // m_cache_first .. m_cache_first + m_cache_count - 1
+    UINT m_cache_first;
+    UINT m_cache_count;
+    cvector<Yast> m_cache;
+    mutable Yast m_scratch;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+class ListCtrlVirtual : public ListCtrl
+{
+public:
+    ListCtrlVirtual(HWND hWnd = nullptr, UINT num_columns = 1) :
+        ListCtrl(hWnd),
+        m_model(num_columns)
+    {
+    }
+    ListCtrlVirtual& operator=(const BaseWnd& src)
+    {
+        m_hWnd = src.m_hWnd;
+        return *this;
+    }
+
+    LcvModel& Model()
+    {
+        return m_model;
+    }
+
+    // Handles LVN_GETDISPINFO, LVN_ODCACHEHINT and LVN_ODFINDITEM.
+    LRESULT HandleReflectedNotify(NMHDR* pNMHDR);
+
+    // Must be called after rows have been added, removed or reordered. Keeps
+    // the scroll position.
+    void Refresh();
+
+    // Sort by the text of column 'col' and repaint.
+    void SortBy(int col_idx, bool ascending);
+
+    int RowFromIndex(int idx)
+    {
+        return static_cast<int>(m_model.view_to_row(idx));
+    }
+
+    // rows are owned by the model, so these have to be done there
+    int InsertItem(LVITEM& item) = delete;
+    bool DeleteItem(int idx) = delete;
+    bool SetItemText(int idx, int col_idx, PCTSTR pText) = delete;
+    bool SetItemData(int idx, intptr_t data) = delete;
+    UINT InsertItems(
+        const LcTextView* texts,
+        UINT num_cols,
+        const intptr_t* data,
+        UINT num_rows
+        ) = delete;
+
+    // the model changes behind the back of ListCtrl, so a cache would go
+    // stale immediately
+    bool EnableTextCache(bool enable) = delete;
+
+    void DeleteAllItems();
+    intptr_t GetItemData(int idx);
+    Yast GetItemText(int idx, int col_idx);
+
+protected:
+
+    void OnGetDispInfo(NMLVDISPINFOW* pDI);
+    int OnFindItem(NMLVFINDITEMW* pFI);
+
+    LcvModel m_model;
+};
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,128 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// This file is part of the romato library.
+//
+// Copyright 2013-2026 Rocco Matano
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// A list of paths stored back to back in a single character buffer. Adding a
+// path costs no allocation (amortized) and handing a whole batch to another
+// thread is just a swap.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+class PathBatch
+{
+public:
+
+    PathBatch()
+    {
+    }
+
+    PathBatch(PathBatch&& src)
+    {
+        swap(src);
+    }
+
+    PathBatch& operator=(PathBatch&& src)
+    {
+        swap(src);
+        return *this;
+    }
+
+    PathBatch(const PathBatch&) = delete;
+    PathBatch& operator=(const PathBatch&) = delete;
+
+    void add(PCWSTR path, UINT len)
+    {
+        m_offsets.push_back(m_chars.size());
+        m_chars.insert(m_chars.end(), path, path + len);
+        m_chars.push_back(0);
+    }
+
+    void add(PCWSTR path)
+    {
+        add(path, sz_lenW(path));
+    }
+
+    // zero terminated
+    PCWSTR path(UINT idx) const
+    {
+        return m_chars.data() + m_offsets[idx];
+    }
+
+    UINT length(UINT idx) const
+    {
+        const size_t end = (
+            idx + 1 < m_offsets.size() ?
+            m_offsets[idx + 1] :
+            m_chars.size()
+            );
+        return static_cast<UINT>(end - m_offsets[idx] - 1);
+    }
+
+    UINT count() const
+    {
+        return static_cast<UINT>(m_offsets.size());
+    }
+
+    bool empty() const
+    {
+        return m_offsets.empty();
+    }
+
+    // total number of characters including the terminating zeros
+    size_t chars() const
+    {
+        return m_chars.size();
+    }
+
+    void reserve(UINT count, size_t chars)
+    {
+        m_offsets.reserve(count);
+        m_chars.reserve(chars);
+    }
+
+    // Keeps the allocated memory.
+    void clear()
+    {
+        m_offsets.clear();
+        m_chars.clear();
+    }
+
+    void swap(PathBatch& other)
+    {
+        m_offsets.swap(other.m_offsets);
+        m_chars.swap(other.m_chars);
+    }
+
+protected:
+
+    cvector<size_t> m_offsets;
+    cvector<WCHAR> m_chars;
+};
+
+////////////////////////////////////////////////////////////////////////////////
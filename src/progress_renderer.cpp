@@ -0,0 +1,337 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// This file is part of the romato library.
+//
+// Copyright 2013-2026 Rocco Matano
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "romato.h"
+#include "progress_renderer.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+// (src * a + dst * (255 - a)) / 255 for all three channels at once
+static inline uint32_t blend(uint32_t dst, uint32_t src, uint32_t a)
+{
+    const uint32_t ia = 255 - a;
+    uint32_t rb = (src & 0xff00ff) * a + (dst & 0xff00ff) * ia + 0x800080;
+    rb = ((rb + ((rb >> 8) & 0xff00ff)) >> 8) & 0xff00ff;
+    uint32_t g = (src & 0x00ff00) * a + (dst & 0x00ff00) * ia + 0x008000;
+    g = ((g + ((g >> 8) & 0x00ff00)) >> 8) & 0x00ff00;
+    return rb | g;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+static inline void fill(
+    uint32_t* pixels,
+    int stride,
+    int x0,
+    int y0,
+    int x1,
+    int y1,
+    uint32_t color
+    )
+{
+    for (int y = y0; y < y1; y++)
+    {
+        uint32_t* row = pixels + static_cast<intptr_t>(y) * stride;
+        for (int x = x0; x < x1; x++)
+        {
+            row[x] = color;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void progress_compose_cell(
+    uint32_t* pixels,
+    int stride,
+    int width,
+    int height,
+    int percent,
+    const ProgressGlyphs* glyphs,
+    const ProgressColors& colors
+    )
+{
+    fill(pixels, stride, 0, 0, width, height, colors.background);
+    if (width < 3 || height < 3)
+    {
+        return;
+    }
+
+    // frame
+    fill(pixels, stride, 0, 0, width - 1, 1, colors.frame);
+    fill(pixels, stride, 0, 1, 1, height - 1, colors.frame);
+    fill(pixels, stride, width - 1, 0, width, height, colors.shadow);
+    fill(pixels, stride, 0, height - 1, width, height, colors.shadow);
+
+    if (percent <= 0)
+    {
+        return;
+    }
+    if (percent > 100)
+    {
+        percent = 100;
+    }
+
+    // bar
+    const int x0 = 1;
+    const int y0 = 1;
+    const int x1 = width - 1;
+    const int y1 = height - 1;
+    const int bar_end = x0 + (x1 - x0) * percent / 100;
+    fill(pixels, stride, x0, y0, bar_end, y1, colors.bar);
+
+    if (!glyphs || glyphs->coverage.empty())
+    {
+        return;
+    }
+
+    // label, centered and clipped to the interior
+    const int lw = glyphs->extent[percent];
+    const int lh = glyphs->height;
+    const int lx = x0 + ((x1 - x0) - lw) / 2;
+    const int ly = y0 + ((y1 - y0) - lh) / 2;
+    const int cx0 = lx < x0 ? x0 : lx;
+    const int cy0 = ly < y0 ? y0 : ly;
+    const int cx1 = lx + lw > x1 ? x1 : lx + lw;
+    const int cy1 = ly + lh > y1 ? y1 : ly + lh;
+    const BYTE* strip = glyphs->coverage.data() + glyphs->offset[percent];
+    for (int y = cy0; y < cy1; y++)
+    {
+        uint32_t* row = pixels + static_cast<intptr_t>(y) * stride;
+        const BYTE* cov = strip + static_cast<intptr_t>(y - ly) * glyphs->width;
+        for (int x = cx0; x < cx1; x++)
+        {
+            const uint32_t a = cov[x - lx];
+            if (a)
+            {
+                const uint32_t clr = x < bar_end ? colors.bar_text : colors.text;
+                row[x] = blend(row[x], clr, a);
+            }
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+static inline uint32_t dib_color(COLORREF clr)
+{
+    return (
+        (static_cast<uint32_t>(GetRValue(clr)) << 16) |
+        (static_cast<uint32_t>(GetGValue(clr)) << 8) |
+        GetBValue(clr)
+        );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+static HBITMAP create_dib(HDC hdc, int width, int height, uint32_t** bits)
+{
+    BITMAPINFO bmi;
+    memset(&bmi, 0, sizeof(bmi));
+    bmi.bmiHeader.biSize = sizeof(bmi.bmiHeader);
+    bmi.bmiHeader.biWidth = width;
+    bmi.bmiHeader.biHeight = -height;       // top-down
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biBitCount = 32;
+    bmi.bmiHeader.biCompression = BI_RGB;
+    void* pv = nullptr;
+    HBITMAP res = CreateDIBSection(hdc, &bmi, DIB_RGB_COLORS, &pv, nullptr, 0);
+    *bits = static_cast<uint32_t*>(pv);
+    return res;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ProgressRenderer::Reset()
+{
+    if (m_mem_dc)
+    {
+        if (m_dib)
+        {
+            SelectObject(m_mem_dc, m_old_bmp);
+            DeleteObject(m_dib);
+        }
+        DeleteDC(m_mem_dc);
+    }
+    m_mem_dc = nullptr;
+    m_dib = nullptr;
+    m_old_bmp = nullptr;
+    m_bits = nullptr;
+    m_dib_width = 0;
+    m_dib_height = 0;
+    m_glyph_font = nullptr;
+    m_glyphs.coverage.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool ProgressRenderer::EnsureBuffer(HDC hdc, int width, int height)
+{
+    if (m_dib && width <= m_dib_width && height <= m_dib_height)
+    {
+        return true;
+    }
+    if (!m_mem_dc)
+    {
+        m_mem_dc = CreateCompatibleDC(hdc);
+        if (!m_mem_dc)
+        {
+            return false;
+        }
+    }
+    if (m_dib)
+    {
+        SelectObject(m_mem_dc, m_old_bmp);
+        DeleteObject(m_dib);
+    }
+
+    // only grow, cells of a list usually share their size
+    m_dib_width = width > m_dib_width ? width : m_dib_width;
+    m_dib_height = height > m_dib_height ? height : m_dib_height;
+    m_dib = create_dib(hdc, m_dib_width, m_dib_height, &m_bits);
+    if (!m_dib)
+    {
+        m_dib_width = m_dib_height = 0;
+        return false;
+    }
+    m_old_bmp = SelectObject(m_mem_dc, m_dib);
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ProgressRenderer::EnsureGlyphs(HDC hdc)
+{
+    HGDIOBJ font = GetCurrentObject(hdc, OBJ_FONT);
+    if (font == m_glyph_font && !m_glyphs.coverage.empty())
+    {
+        return;
+    }
+    m_glyph_font = font;
+    m_glyphs.coverage.clear();
+
+    WCHAR labels[101][8];
+    int lengths[101];
+    int total = 0;
+    int height = 0;
+    for (int i = 0; i <= 100; i++)
+    {
+        lengths[i] = sz_nprintfW(labels[i], ARRAY_SIZE(labels[i]), L"%d%%", i);
+        SIZE size = {0, 0};
+        GetTextExtentPoint32W(hdc, labels[i], lengths[i], &size);
+        m_glyphs.offset[i] = total;
+        m_glyphs.extent[i] = size.cx;
+        total += size.cx;
+        height = size.cy > height ? size.cy : height;
+    }
+    if (total <= 0 || height <= 0)
+    {
+        return;
+    }
+
+    // White text on black: the green channel is the coverage.
+    HDC dc = CreateCompatibleDC(hdc);
+    uint32_t* bits = nullptr;
+    HBITMAP dib = create_dib(hdc, total, height, &bits);
+    if (dc && dib)
+    {
+        HGDIOBJ old_bmp = SelectObject(dc, dib);
+        HGDIOBJ old_font = SelectObject(dc, font);
+        memset(bits, 0, static_cast<size_t>(total) * height * sizeof(uint32_t));
+        SetBkMode(dc, TRANSPARENT);
+        SetTextColor(dc, RGB(255, 255, 255));
+        for (int i = 0; i <= 100; i++)
+        {
+            ExtTextOutW(
+                dc,
+                m_glyphs.offset[i],
+                0,
+                0,
+                nullptr,
+                labels[i],
+                lengths[i],
+                nullptr
+                );
+        }
+        GdiFlush();
+
+        const size_t cnt = static_cast<size_t>(total) * height;
+        m_glyphs.coverage.resize(cnt);
+        for (size_t i = 0; i < cnt; i++)
+        {
+            m_glyphs.coverage[i] = static_cast<BYTE>(bits[i] >> 8);
+        }
+        m_glyphs.width = total;
+        m_glyphs.height = height;
+
+        SelectObject(dc, old_font);
+        SelectObject(dc, old_bmp);
+    }
+    if (dib)
+    {
+        DeleteObject(dib);
+    }
+    if (dc)
+    {
+        DeleteDC(dc);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ProgressRenderer::Draw(HDC hdc, const RECT& rc, int percent)
+{
+    const int width = rc.right - rc.left;
+    const int height = rc.bottom - rc.top;
+    if (width <= 0 || height <= 0 || !EnsureBuffer(hdc, width, height))
+    {
+        return;
+    }
+    EnsureGlyphs(hdc);
+
+    ProgressColors colors;
+    colors.frame = 0;
+    colors.shadow = dib_color(GetSysColor(COLOR_BTNSHADOW));
+    colors.background = dib_color(RGB(224, 224, 224));
+    colors.bar = dib_color(GetSysColor(COLOR_HIGHLIGHT));
+    colors.text = dib_color(GetSysColor(COLOR_WINDOWTEXT));
+    colors.bar_text = dib_color(GetSysColor(COLOR_HIGHLIGHTTEXT));
+
+    // GDI might still be working on the DIB
+    GdiFlush();
+    progress_compose_cell(
+        m_bits,
+        m_dib_width,
+        width,
+        height,
+        percent,
+        &m_glyphs,
+        colors
+        );
+    BitBlt(hdc, rc.left, rc.top, width, height, m_mem_dc, 0, 0, SRCCOPY);
+}
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,124 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// This file is part of the romato library.
+//
+// Copyright 2013-2026 Rocco Matano
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Renders progress bar cells into an off-screen 32 bpp DIB section and blits
+// each cell with a single BitBlt.
+//
+// The labels "0%" .. "100%" are rendered only once per font into a glyph
+// strip that holds the text coverage (0 .. 255) of every pixel. Composing a
+// cell is then plain pixel arithmetic (progress_compose_cell), which does not
+// depend on GDI at all.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// Colors are in DIB order, i.e. 0x00RRGGBB.
+
+struct ProgressColors
+{
+    uint32_t frame;         // top and left border
+    uint32_t shadow;        // bottom and right border
+    uint32_t background;
+    uint32_t bar;
+    uint32_t text;          // label outside of the bar
+    uint32_t bar_text;      // label on top of the bar
+};
+
+// Coverage of the labels for 0 .. 100 percent, all in one strip.
+
+struct ProgressGlyphs
+{
+    cvector<BYTE> coverage;     // width * height bytes
+    int width;
+    int height;
+    int offset[101];            // x position of every label in the strip
+    int extent[101];            // width of every label
+};
+
+// 'pixels' points to the top left pixel of a width x height cell, 'stride'
+// is the distance between two rows in pixels. 'glyphs' may be nullptr, in
+// which case no label is drawn. A 'percent' of 0 draws the empty frame only.
+void progress_compose_cell(
+    uint32_t* pixels,
+    int stride,
+    int width,
+    int height,
+    int percent,
+    const ProgressGlyphs* glyphs,
+    const ProgressColors& colors
+    );
+
+////////////////////////////////////////////////////////////////////////////////
+
+class ProgressRenderer
+{
+public:
+
+    ProgressRenderer() :
+        m_mem_dc(nullptr),
+        m_dib(nullptr),
+        m_old_bmp(nullptr),
+        m_bits(nullptr),
+        m_dib_width(0),
+        m_dib_height(0),
+        m_glyph_font(nullptr)
+    {
+    }
+    ~ProgressRenderer()
+    {
+        Reset();
+    }
+
+    ProgressRenderer(const ProgressRenderer&) = delete;
+    ProgressRenderer& operator=(const ProgressRenderer&) = delete;
+
+    // Draws the cell into 'rc' of 'hdc' using the font currently selected
+    // into 'hdc'.
+    void Draw(HDC hdc, const RECT& rc, int percent);
+
+    // Releases all GDI objects and cached glyphs.
+    void Reset();
+
+protected:
+
+    bool EnsureBuffer(HDC hdc, int width, int height);
+    void EnsureGlyphs(HDC hdc);
+
+    HDC m_mem_dc;
+    HBITMAP m_dib;
+    HGDIOBJ m_old_bmp;
+    uint32_t* m_bits;
+    int m_dib_width;
+    int m_dib_height;
+
+    HGDIOBJ m_glyph_font;
+    ProgressGlyphs m_glyphs;
+};
+
+////////////////////////////////////////////////////////////////////////////////
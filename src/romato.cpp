@@ -25,23 +25,45 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 #include "romato.h"
+#include "cmdl_parse.h"
+#include "console_out.h"
 #include <intrin.h>
 
 ////////////////////////////////////////////////////////////////////////////////
 
-_CRTNOALIAS _CRTRESTRICT void* __cdecl malloc(size_t size)
+#if defined(ROMATO_INSTRUMENT_ALLOCS) && ROMATO_INSTRUMENT_ALLOCS
+// SampleAllocation expects malloc to be a frame of its own.
+#define MALLOC_NEVERINLINE NEVERINLINE
+#else
+#define MALLOC_NEVERINLINE
+#endif
+
+_CRTNOALIAS _CRTRESTRICT MALLOC_NEVERINLINE void* __cdecl malloc(size_t size)
 {
+#if defined(ROMATO_INSTRUMENT_ALLOCS) && ROMATO_INSTRUMENT_ALLOCS
+    void* p = HeapAlloc(
+        GetProcessHeap(),
+        HEAP_ZERO_MEMORY | HEAP_GENERATE_EXCEPTIONS,
+        size
+        );
+    AllocStatsOnAlloc(p, size);
+    return p;
+#else
     return HeapAlloc(
         GetProcessHeap(),
         HEAP_ZERO_MEMORY | HEAP_GENERATE_EXCEPTIONS,
         size
         );
+#endif
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
 _CRTNOALIAS void __cdecl free(void* p)
 {
+#if defined(ROMATO_INSTRUMENT_ALLOCS) && ROMATO_INSTRUMENT_ALLOCS
+    AllocStatsOnFree(p);
+#endif
     HeapFree(GetProcessHeap(), 0, p);
 }
 
@@ -206,7 +228,6 @@ void aligned_free(void *aligned)
 #define TABCHAR     TEXT('\t')
 #define QUOTECHAR   TEXT('\"')
 #define BSLASHCHAR  TEXT('\\')
-#define IS_SPACE(p) (*p == SPACECHAR || *p == TABCHAR)
 
 ////////////////////////////////////////////////////////////////////////////////
 //
@@ -257,138 +278,93 @@ void aligned_free(void *aligned)
 //
 // "Ar"g"um"e"n"t" With Sp"aces"" -> single argument 'Argument With Spaces'
 //
+// The parser itself is in cmdl_parse.h.
+//
 ////////////////////////////////////////////////////////////////////////////////
 
-static void parse_cmdl(
-    PTSTR cmdl,
-    PTSTR *argv,
-    PTSTR args,
-    int *nargs,
-    int *nchars
-    )
+int cmdl_to_argv(PTSTR cmdl, PTSTR** ppargv)
 {
-    int argc = 0;
-    int charc = 0;
+    // The buffer is sized from the length of the command line (see
+    // cmdl_parse.h), so that it can be filled in a single scan. Pointers
+    // first, followed by the arguments.
+    const UINT len = simd_len<TCHAR>(cmdl);
+    const UINT max_args = len / 2 + 1;
+    DWORD numbytes = max_args * sizeof(PTSTR) + (len + 1) * sizeof(TCHAR);
+    auto pargv = static_cast<PTSTR*>(malloc(numbytes));
+    if (!pargv)
+    {
+        *ppargv = nullptr;
+        return 0;
+    }
 
-    // loop over arguments
+    auto args = p2p<PTSTR>(&pargv[max_args]);
+    int argc = 0;
+    PCTSTR src = cmdl;
     for (;;)
     {
-        while (IS_SPACE(cmdl))
-        {
-            ++cmdl;
-        }
-
-        if (*cmdl == NULCHAR)
+        src = cmdl_skip_space(src);
+        if (*src == NULCHAR)
         {
-            // no more args
             break;
         }
+        pargv[argc++] = args;
+        src = cmdl_unescape_arg(src, args);
+        *args++ = NULCHAR;
+    }
+    *ppargv = pargv;
+    return argc;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// If 'copy_all' is false, views of arguments that need no unescaping point
+// into 'cmdl', which therefore has to outlive the views.
+static int parse_arg_views(PCTSTR cmdl, ArgView** ppviews, bool copy_all)
+{
+    const UINT len = simd_len<TCHAR>(cmdl);
+    const UINT max_args = len / 2 + 1;
+    DWORD numbytes = max_args * sizeof(ArgView) + (len + 1) * sizeof(TCHAR);
+    auto pviews = static_cast<ArgView*>(malloc(numbytes));
+    if (!pviews)
+    {
+        *ppviews = nullptr;
+        return 0;
+    }
 
-        if (argv)
+    auto args = p2p<PTSTR>(&pviews[max_args]);
+    int argc = 0;
+    PCTSTR src = cmdl;
+    for (;;)
+    {
+        src = cmdl_skip_space(src);
+        if (*src == NULCHAR)
         {
-            *argv++ = args;
+            break;
         }
-        ++argc;
-
-        // - A string of backslashes not followed by a quotation mark has no
-        //   special meaning.
-        // - An even number of backslashes followed by a quotation mark is
-        //   treated as pairs of protected backslashes, followed by a word
-        //   terminator.
-        // - An odd number of backslashes followed by a quotation mark is
-        //   treated as pairs of protected backslashes, followed by a protected
-        //   quotation mark.
-
-        bool space_terminates_arg = true;
-        // loop over chars in argument
-        for (;;)
+        ArgView& view = pviews[argc++];
+        PCTSTR end = cmdl_plain_end(src);
+        if (!copy_all && (*end == NULCHAR || cmdl_is_space(*end)))
         {
-            int cnt_backslash = 0;
-
-            while (*cmdl == BSLASHCHAR)
-            {
-                ++cmdl;
-                ++cnt_backslash;
-            }
-
-            bool ignore = false;
-            if (*cmdl == QUOTECHAR)
-            {
-                if (cnt_backslash % 2 == 0)
-                {
-                    if (!space_terminates_arg && cmdl[1] == QUOTECHAR)
-                    {
-                        cmdl++;
-                    }
-                    else
-                    {
-                        // toggle mode and ignore QUOTECHAR
-                        space_terminates_arg = !space_terminates_arg;
-                        ignore = true;
-                    }
-                }
-                cnt_backslash /= 2;
-            }
-
-            while (cnt_backslash--)
-            {
-                if (args)
-                {
-                    *args++ = BSLASHCHAR;
-                }
-                ++charc;
-            }
-
-            if (*cmdl == NULCHAR || (space_terminates_arg && IS_SPACE(cmdl)))
-            {
-                // end of argument
-                break;
-            }
-
-            if (!ignore)
-            {
-                if (args)
-                {
-                    *args++ = *cmdl;
-                }
-                ++charc;
-            }
-            ++cmdl;
+            view.str = src;
+            view.len = static_cast<UINT>(end - src);
+            src = end;
         }
-
-        if (args)
+        else
         {
-            *args++ = NULCHAR;
+            view.str = args;
+            src = cmdl_unescape_arg(src, args);
+            view.len = static_cast<UINT>(args - view.str);
         }
-        ++charc;
     }
-    *nargs = argc;
-    *nchars = charc;
+    *ppviews = pviews;
+    return argc;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
-int cmdl_to_argv(PTSTR cmdl, PTSTR** ppargv)
+int cmdl_to_arg_views(PCTSTR cmdl, ArgView** ppviews)
 {
-    // calc size of required buffer
-    int argc, nchars;
-    parse_cmdl(cmdl, nullptr, nullptr, &argc, &nchars);
-
-    // alloc buffer and parse again
-    DWORD numbytes = argc * sizeof(PTSTR) + nchars * sizeof(TCHAR);
-    auto pargv = static_cast<PTSTR*>(malloc(numbytes));
-    if (pargv)
-    {
-        auto args = p2p<PTSTR>(&pargv[argc]);
-        parse_cmdl(cmdl, pargv, args, &argc, &nchars);
-        *ppargv = pargv;
-    }
-    else
-    {
-        *ppargv = nullptr;
-        argc = 0;
-    }
-    return argc;
+    return parse_arg_views(cmdl, ppviews, false);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -407,122 +383,118 @@ int get_argv(PTSTR** ppargv)
 
 ////////////////////////////////////////////////////////////////////////////////
 
+int get_argv_views(ArgView** ppviews)
+{
+    // The command line of the process stays valid, so most views can point
+    // right into it. The fallback lives on the stack and has to be copied.
+    auto cmdl = GetCommandLine();
+    if (cmdl == 0 || *cmdl == NULCHAR)
+    {
+        TCHAR prog_name[MAX_PATH + 1];
+        GetModuleFileName(nullptr, prog_name, MAX_PATH);
+        return parse_arg_views(prog_name, ppviews, true);
+    }
+    return parse_arg_views(cmdl, ppviews, false);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 void free_argv(PTSTR* pargv)
 {
-    HeapFree(GetProcessHeap(), 0, pargv);
+    free(pargv);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void free_arg_views(ArgView* pviews)
+{
+    free(pviews);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 
-static int find_any(PCTSTR s, PCTSTR pool)
+static PTSTR put_backslashes(PTSTR out, int cnt)
 {
-    while (*s)
+    while (cnt-- > 0)
     {
-        auto p = pool;
-        while (*p && *p != *s)
-        {
-            ++p;
-        }
-        if (*p == *s) return 1;
-        ++s;
+        *out++ = BSLASHCHAR;
     }
-    return 0;
+    return out;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
-static int append_arg(PTSTR arg, PTSTR cmdl)
+// Writes 'arg' to 'out' (quoted if necessary) and returns the position after
+// it. At most 2 * len + 2 characters are written.
+static PTSTR append_arg(PCTSTR arg, PTSTR out)
 {
-    if (cmdl)
-    {
-        cmdl += sz_len(cmdl);
-    }
-
-    const int len = sz_len(arg);
     // Args that are not empty and do not contain any of (space, tab, new line
     // or quotation mark) do not need to be qouted.
-    if (!((len == 0) || find_any(arg, TEXT(" \t\n\""))))
-    {
-        if (cmdl)
+    PCTSTR end = simd_find(arg, [](__m128i v)
         {
-            memcpy(cmdl, arg, len * sizeof(TCHAR));
-            cmdl += len;
-        }
-        return len;
+            return _mm_or_si128(
+                _mm_or_si128(simd_eq(v, SPACECHAR), simd_eq(v, TABCHAR)),
+                _mm_or_si128(simd_eq(v, TEXT('\n')), simd_eq(v, QUOTECHAR))
+                );
+        });
+    if (*end == NULCHAR && end != arg)
+    {
+        const size_t len = end - arg;
+        memcpy(out, arg, len * sizeof(TCHAR));
+        return out + len;
     }
 
     // have to qoute
-    if (cmdl)
-    {
-        *cmdl++ = TEXT('"');
-    }
-    int res = 1;
-    while (*arg)
+    *out++ = QUOTECHAR;
+    for (;;)
     {
+        // copy the run up to the next backslash or quotation mark in one go
+        end = simd_find(arg, [](__m128i v)
+            {
+                return _mm_or_si128(
+                    simd_eq(v, BSLASHCHAR),
+                    simd_eq(v, QUOTECHAR)
+                    );
+            });
+        const size_t len = end - arg;
+        memcpy(out, arg, len * sizeof(TCHAR));
+        out += len;
+        arg = end;
+
         int cnt_backslash = 0;
-        while (*arg == TEXT('\\'))
+        while (*arg == BSLASHCHAR)
         {
             ++arg;
             ++cnt_backslash;
         }
 
-        if (*arg == 0)
+        if (*arg == NULCHAR)
         {
             // Add a pair of backslashes for each encountered backslash, so
             // that the quotation mark we are going to add below will be
             // interpreted as an argument terminator.
-            const int nbs = cnt_backslash * 2;
-            if (cmdl)
-            {
-                for (int i = 0; i < nbs; i++)
-                {
-                    *cmdl++ = TEXT('\\');
-                }
-            }
-            res += nbs;
+            out = put_backslashes(out, cnt_backslash * 2);
             break;
         }
-        else if (*arg == TEXT('"'))
+        else if (*arg == QUOTECHAR)
         {
             // Escape all backslashes and the following double quotation mark
             // (so that there is an odd number of backslashes).
-            const int nbs = cnt_backslash * 2 + 1;
-            if (cmdl)
-            {
-                for (int i = 0; i < nbs; i++)
-                {
-                    *cmdl++ = TEXT('\\');
-                }
-                *cmdl++ = *arg;
-            }
-            res += nbs + 1;
+            out = put_backslashes(out, cnt_backslash * 2 + 1);
+            *out++ = *arg++;
         }
         else
         {
             // If we are not at the end of an argument and are not processing
             // a quotation mark, then we simply copy the backslashes to the
-            // output.
-            const int nbs = cnt_backslash;
-            if (cmdl)
-            {
-                for (int i = 0; i < nbs; i++)
-                {
-                    *cmdl++ = TEXT('\\');
-                }
-                *cmdl++ = *arg;
-            }
-            res += nbs + 1;
+            // output (the following character is copied with the next run).
+            out = put_backslashes(out, cnt_backslash);
         }
-        ++arg;
     }
-    if (cmdl)
-    {
-        *cmdl++ = TEXT('"');
-    }
-    res += 1;
-    return res;
+    *out++ = QUOTECHAR;
+    return out;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -534,24 +506,24 @@ PTSTR argv_to_cmdl(int argc, PTSTR argv[])
         return nullptr;
     }
 
-    int size = argc;    // number of delimiting spaces + terminating zero
+    // Quoting at most doubles the length of an argument and adds two
+    // quotation marks. One more character for the delimiting space or the
+    // terminating zero. Over-allocating a bit is much cheaper than measuring
+    // the exact size in a separate pass.
+    size_t size = 0;
     for (int i = 0; i < argc; i++)
     {
-        size += append_arg(argv[i], nullptr);
+        size += 2 * static_cast<size_t>(simd_len<TCHAR>(argv[i])) + 3;
     }
     auto cmdl = static_cast<PTSTR>(malloc(size * sizeof(TCHAR)));
-    *cmdl = 0;
-    size = 0;
+
+    PTSTR out = cmdl;
     for (int i = 0; i < argc; i++)
     {
-        size += append_arg(argv[i], cmdl);
-        if (i < (argc - 1))
-        {
-            *(cmdl + size) = TEXT(' ');
-            ++size;
-        }
-        *(cmdl + size) = 0;
+        out = append_arg(argv[i], out);
+        *out++ = SPACECHAR;
     }
+    out[-1] = NULCHAR;
     return cmdl;
 }
 
@@ -559,7 +531,7 @@ PTSTR argv_to_cmdl(int argc, PTSTR argv[])
 
 void free_cmdl(PTSTR cmdl)
 {
-    HeapFree(GetProcessHeap(), 0, cmdl);
+    free(cmdl);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -675,83 +647,82 @@ void DbgPrintf(const char* fmt, ...)
     va_end(argptr);
     OutputDebugStringA(buffer);
 }
+
 ////////////////////////////////////////////////////////////////////////////////
 
-void DbgDump(const void* data, size_t len)
+void DbgSinkDebugString(void* ctx, const char* data, size_t len)
 {
-    const int bytes_per_line = 16;
-    const int line_buf_size = 22 + bytes_per_line * 4;
-    const int first_printable = 32; // ' ' (space)
-    const int last_printable = 127; // '~'
-    char line_buf[line_buf_size];
-
-    DbgPrintf("Dump of %p, length %zu (%#zx)\n", data, len, len);
-
-    auto const start = reinterpret_cast<const uint8_t*>(data);
-    auto const end = start + len;
-    auto *chunk = start;
+    UNUSED(ctx);
+    char buffer[4096];
     while (len)
     {
-        auto out = (
-            line_buf +
-            sz_nprintfA(line_buf, sizeof(line_buf), "%08tx: ", chunk - start)
-            );
-        for (int i = 0; i < bytes_per_line; i++)
+        // Prefer to split at a line break, so that a debugger or DebugView
+        // does not show lines broken in two.
+        size_t num = len;
+        if (num >= sizeof(buffer))
         {
-            if (chunk + i < end)
+            num = sizeof(buffer) - 1;
+            while (num > sizeof(buffer) / 2 && data[num - 1] != '\n')
             {
-                uint32_t n = (chunk[i] >> 4) & 0x0f;
-                *out++ = static_cast<char>(n + (n > 9 ? 'a' - 10 : '0'));
-                n = chunk[i] & 0x0f;
-                *out++ = static_cast<char>(n + (n > 9 ? 'a' - 10 : '0'));
+                num--;
             }
-            else
+            if (data[num - 1] != '\n')
             {
-                *out++ = ' ';
-                *out++ = ' ';
+                num = sizeof(buffer) - 1;
             }
-            *out++ = (i == (bytes_per_line / 2 - 1)) ? '|' : ' ';
         }
-        *out++ = '|';
-        *out++ = ' ';
-        for (int i = 0; i < bytes_per_line; i++)
+        memcpy(buffer, data, num);
+        buffer[num] = 0;
+        OutputDebugStringA(buffer);
+        data += num;
+        len -= num;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void DbgSinkFile(void* ctx, const char* data, size_t len)
+{
+    while (len)
+    {
+        const DWORD max_write = 0x40000000;
+        const DWORD num = len < max_write ? static_cast<DWORD>(len) : max_write;
+        DWORD written = 0;
+        if (!WriteFile(ctx, data, num, &written, nullptr) || !written)
         {
-            uint8_t c = ' ';
-            if (chunk + i < end)
-            {
-                c = chunk[i];
-                if (c < first_printable || c > last_printable)
-                {
-                    c = '.';
-                }
-            }
-            *out++ = c;
+            break;
         }
-        chunk += bytes_per_line;
-        len = (len > bytes_per_line) ? len - bytes_per_line : 0;
-        *out++ = '\n';
-        *out = '\0';
-        OutputDebugStringA(line_buf);
+        data += written;
+        len -= written;
     }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
+void DbgDump(const void* data, size_t len)
+{
+    DbgPrintf("Dump of %p, length %zu (%#zx)\n", data, len, len);
+    HexDump(data, len, nullptr, nullptr);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 #if defined(ROMATO_INCLUDE_SIMPLE_PRINTF) && ROMATO_INCLUDE_SIMPLE_PRINTF
 
 extern "C" int printf(const char *fmt, ...)
 {
-    char buf[1025];
     va_list args;
     va_start(args, fmt);
-    int res = sz_vnprintfA(buf, sizeof(buf), fmt, args);
+    const int res = g_stdout.vprintf(fmt, args);
     va_end(args);
-    DWORD cnt = res < sizeof(buf) ? res : sizeof(buf) - 1;
-    return (
-        WriteFile(GetStdHandle(STD_OUTPUT_HANDLE), buf, cnt, &cnt, NULL) ?
-        cnt :
-        0
-        );
+    return res;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+extern "C" int puts(const char* str)
+{
+    return g_stdout.puts(str) ? 0 : -1;
 }
 
 #endif
@@ -37,6 +37,18 @@
 #include "char_from_w.h"
 #include "string_res.h"
 #include "yast.h"
+#include "yast_atom.h"
+#include "shared_yast.h"
 #include "container.h"
 #include "coords.h"
 #include "romato_reg.h"
+#include "romato_alloc_stats.h"
+#include "hex_dump.h"
+
+#if defined(ROMATO_TRACE_RING) && ROMATO_TRACE_RING
+#include "romato_trace.h"
+#endif
+
+#if defined(ROMATO_ACTIVATE_PERF) && ROMATO_ACTIVATE_PERF
+#include "romato_perf.h"
+#endif
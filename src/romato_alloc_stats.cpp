@@ -0,0 +1,411 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// This file is part of the romato library.
+//
+// Copyright 2013-2026 Rocco Matano
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "romato.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+#if defined(ROMATO_INSTRUMENT_ALLOCS) && ROMATO_INSTRUMENT_ALLOCS
+
+namespace {
+
+// The counters of one thread. Only that thread writes them, everybody may
+// read them.
+struct AllocThreadStats
+{
+    std::atomic<UINT64> allocs;
+    std::atomic<UINT64> frees;
+    std::atomic<UINT64> bytes_allocated;
+    std::atomic<UINT64> bytes_freed;
+    std::atomic<UINT64> size_classes[ALLOC_SIZE_CLASSES];
+    UINT since_sample;
+    AllocThreadStats* next;
+};
+
+struct AllocSiteEntry
+{
+    ULONG hash;
+    AllocSite site;
+};
+
+const UINT SITE_TABLE_SIZE = 1024;
+
+} // namespace
+
+// Intentionally no objects with constructors, because static constructors
+// are only executed if ROMATO_CONSTRUCT_STATIC_OBJECTS is set.
+static std::atomic<DWORD> s_tls(TLS_OUT_OF_INDEXES);
+static INIT_ONCE s_init_once = INIT_ONCE_STATIC_INIT;
+static std::atomic<AllocThreadStats*> s_threads;
+static std::atomic<UINT> s_sample_rate;
+static SRWLOCK s_site_lock = SRWLOCK_INIT;
+static AllocSiteEntry s_sites[SITE_TABLE_SIZE];
+static UINT64 s_sites_lost;
+
+////////////////////////////////////////////////////////////////////////////////
+
+static BOOL CALLBACK InitAllocStats(INIT_ONCE*, void*, void**)
+{
+    s_tls.store(TlsAlloc(), std::memory_order_relaxed);
+    return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+static AllocThreadStats* CreateThreadStats()
+{
+    InitOnceExecuteOnce(&s_init_once, InitAllocStats, nullptr, nullptr);
+
+    // Must not use malloc here. The memory is never released, so the
+    // counters of a thread survive the thread.
+    void* mem = HeapAlloc(
+        GetProcessHeap(),
+        HEAP_ZERO_MEMORY,
+        sizeof(AllocThreadStats)
+        );
+    if (!mem)
+    {
+        return nullptr;
+    }
+    auto self = new (mem) AllocThreadStats();
+    AllocThreadStats* head = s_threads.load(std::memory_order_relaxed);
+    do
+    {
+        self->next = head;
+    }
+    while (!s_threads.compare_exchange_weak(
+        head,
+        self,
+        std::memory_order_release,
+        std::memory_order_relaxed
+        ));
+    TlsSetValue(s_tls.load(std::memory_order_relaxed), self);
+    return self;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+static AllocThreadStats* CurrentThreadStats()
+{
+    // malloc and free must not change the last error
+    const DWORD err = GetLastError();
+    auto self = static_cast<AllocThreadStats*>(
+        TlsGetValue(s_tls.load(std::memory_order_relaxed))
+        );
+    if (!self)
+    {
+        self = CreateThreadStats();
+    }
+    SetLastError(err);
+    return self;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// single writer, so no need for an interlocked operation
+static inline void Add(std::atomic<UINT64>& counter, UINT64 val)
+{
+    counter.store(
+        counter.load(std::memory_order_relaxed) + val,
+        std::memory_order_relaxed
+        );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+static UINT SizeClass(size_t size)
+{
+    // the bit scan leaves 'msb' undefined for 0
+    if (!size)
+    {
+        return 0;
+    }
+    unsigned long msb;
+#ifdef _WIN64
+    _BitScanReverse64(&msb, size);
+#else
+    _BitScanReverse(&msb, size);
+#endif
+    return msb < ALLOC_SIZE_CLASSES ? msb : ALLOC_SIZE_CLASSES - 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Must not be inlined (neither must AllocStatsOnAlloc and malloc), so that
+// the number of frames to skip is known.
+static NEVERINLINE void SampleAllocation(size_t size)
+{
+    void* frames[ALLOC_SITE_FRAMES];
+    ULONG hash = 0;
+
+    // skip SampleAllocation, AllocStatsOnAlloc and malloc
+    const UINT num = RtlCaptureStackBackTrace(
+        3,
+        ALLOC_SITE_FRAMES,
+        frames,
+        &hash
+        );
+    if (!num)
+    {
+        return;
+    }
+
+    AcquireSRWLockExclusive(&s_site_lock);
+    UINT idx = hash % SITE_TABLE_SIZE;
+    for (UINT probe = 0; probe < SITE_TABLE_SIZE; probe++)
+    {
+        AllocSiteEntry& entry = s_sites[idx];
+        if (!entry.site.num_frames)
+        {
+            entry.hash = hash;
+            entry.site.num_frames = num;
+            memcpy(entry.site.frames, frames, num * sizeof(void*));
+        }
+        if (
+            entry.hash == hash &&
+            entry.site.num_frames == num &&
+            memcmp(entry.site.frames, frames, num * sizeof(void*)) == 0
+            )
+        {
+            entry.site.samples++;
+            entry.site.bytes += size;
+            ReleaseSRWLockExclusive(&s_site_lock);
+            return;
+        }
+        idx = (idx + 1) % SITE_TABLE_SIZE;
+    }
+    s_sites_lost++;
+    ReleaseSRWLockExclusive(&s_site_lock);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+NEVERINLINE void AllocStatsOnAlloc(void* p, size_t size)
+{
+    AllocThreadStats* self = CurrentThreadStats();
+    if (!p || !self)
+    {
+        return;
+    }
+    Add(self->allocs, 1);
+    Add(self->bytes_allocated, size);
+    Add(self->size_classes[SizeClass(size)], 1);
+
+    const UINT rate = s_sample_rate.load(std::memory_order_relaxed);
+    if (rate && ++self->since_sample >= rate)
+    {
+        self->since_sample = 0;
+        SampleAllocation(size);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void AllocStatsOnFree(void* p)
+{
+    AllocThreadStats* self = CurrentThreadStats();
+    if (!p || !self)
+    {
+        return;
+    }
+    const SIZE_T size = HeapSize(GetProcessHeap(), 0, p);
+    Add(self->frees, 1);
+    if (size != static_cast<SIZE_T>(-1))
+    {
+        Add(self->bytes_freed, size);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool AllocStatsSnapshot(AllocStats& stats)
+{
+    memset(&stats, 0, sizeof(stats));
+    AllocThreadStats* t = s_threads.load(std::memory_order_acquire);
+    for (; t; t = t->next)
+    {
+        stats.allocs += t->allocs.load(std::memory_order_relaxed);
+        stats.frees += t->frees.load(std::memory_order_relaxed);
+        stats.bytes_allocated += t->bytes_allocated.load(
+            std::memory_order_relaxed
+            );
+        stats.bytes_freed += t->bytes_freed.load(std::memory_order_relaxed);
+        for (UINT i = 0; i < ALLOC_SIZE_CLASSES; i++)
+        {
+            stats.size_classes[i] += t->size_classes[i].load(
+                std::memory_order_relaxed
+                );
+        }
+    }
+    stats.live_bytes = static_cast<INT64>(
+        stats.bytes_allocated - stats.bytes_freed
+        );
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void AllocStatsSetSampleRate(UINT every_n)
+{
+    s_sample_rate.store(every_n, std::memory_order_relaxed);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+UINT AllocStatsSites(AllocSite* sites, UINT max_sites)
+{
+    // insertion sort into the output array, that only keeps the top entries
+    UINT num = 0;
+    AcquireSRWLockShared(&s_site_lock);
+    for (const AllocSiteEntry& entry : s_sites)
+    {
+        if (!entry.site.samples)
+        {
+            continue;
+        }
+        UINT pos = num;
+        while (pos && sites[pos - 1].bytes < entry.site.bytes)
+        {
+            if (pos < max_sites)
+            {
+                sites[pos] = sites[pos - 1];
+            }
+            pos--;
+        }
+        if (pos < max_sites)
+        {
+            sites[pos] = entry.site;
+            if (num < max_sites)
+            {
+                num++;
+            }
+        }
+    }
+    ReleaseSRWLockShared(&s_site_lock);
+    return num;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+#else // ROMATO_INSTRUMENT_ALLOCS
+
+bool AllocStatsSnapshot(AllocStats& stats)
+{
+    memset(&stats, 0, sizeof(stats));
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void AllocStatsSetSampleRate(UINT every_n)
+{
+    UNUSED(every_n);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+UINT AllocStatsSites(AllocSite* sites, UINT max_sites)
+{
+    UNUSED(sites);
+    UNUSED(max_sites);
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif // ROMATO_INSTRUMENT_ALLOCS
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool AllocStatsDump(DBG_SINK_FUNC sink, void* ctx)
+{
+    AllocStats stats;
+    if (!AllocStatsSnapshot(stats))
+    {
+        return false;
+    }
+    if (!sink)
+    {
+        sink = DbgSinkDebugString;
+    }
+
+    char buf[512];
+    int len = sz_nprintfA(
+        buf,
+        sizeof(buf),
+        "allocs: %llu, frees: %llu, allocated: %llu, freed: %llu, "
+        "live: %lld\n",
+        stats.allocs,
+        stats.frees,
+        stats.bytes_allocated,
+        stats.bytes_freed,
+        stats.live_bytes
+        );
+    sink(ctx, buf, len);
+
+    for (UINT i = 0; i < ALLOC_SIZE_CLASSES; i++)
+    {
+        if (stats.size_classes[i])
+        {
+            len = sz_nprintfA(
+                buf,
+                sizeof(buf),
+                "%12llu bytes and up: %llu\n",
+                i ? UINT64(1) << i : UINT64(0),
+                stats.size_classes[i]
+                );
+            sink(ctx, buf, len);
+        }
+    }
+
+    AllocSite sites[16];
+    const UINT num_sites = AllocStatsSites(sites, ARRAY_SIZE(sites));
+    for (UINT i = 0; i < num_sites; i++)
+    {
+        len = sz_nprintfA(
+            buf,
+            sizeof(buf),
+            "site %u: %llu samples, %llu bytes, stack:",
+            i,
+            sites[i].samples,
+            sites[i].bytes
+            );
+        for (UINT f = 0; f < sites[i].num_frames; f++)
+        {
+            len += sz_nprintfA(
+                buf + len,
+                sizeof(buf) - len,
+                " %p",
+                sites[i].frames[f]
+                );
+        }
+        buf[len++] = '\n';
+        sink(ctx, buf, len);
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
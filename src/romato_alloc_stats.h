@@ -0,0 +1,100 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// This file is part of the romato library.
+//
+// Copyright 2013-2026 Rocco Matano
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "romato_macros.h"
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Allocation statistics.
+//
+// If ROMATO_INSTRUMENT_ALLOCS is set, malloc and free (and therefore new,
+// delete and everything that is built on top of them) count the number of
+// allocations and the bytes per thread and sort the allocation sizes into
+// power-of-two classes. The counters are only written by the thread they
+// belong to, so there is neither a lock nor a contended cache line.
+//
+// Additionally every n-th allocation of a thread can be sampled (see
+// AllocStatsSetSampleRate). For a sample the call stack is captured and
+// accounted to its call site, which makes it possible to find the code that
+// causes most of the allocations.
+//
+// Without ROMATO_INSTRUMENT_ALLOCS malloc and free are not touched at all,
+// the functions below still exist, but report nothing.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+const UINT ALLOC_SIZE_CLASSES = 32;
+const UINT ALLOC_SITE_FRAMES = 8;
+
+struct AllocStats
+{
+    UINT64 allocs;
+    UINT64 frees;
+    UINT64 bytes_allocated;
+    UINT64 bytes_freed;
+
+    // Memory can be freed by another thread than the one that allocated it,
+    // so this is only meaningful for the sum of all threads.
+    INT64 live_bytes;
+
+    // size_classes[i] counts the allocations of 2^i up to 2^(i+1) - 1 bytes
+    // (class 0 includes 0 bytes, the last class everything that is larger)
+    UINT64 size_classes[ALLOC_SIZE_CLASSES];
+};
+
+struct AllocSite
+{
+    void* frames[ALLOC_SITE_FRAMES];
+    UINT num_frames;
+    UINT64 samples;
+    UINT64 bytes;
+};
+
+// Sums up the counters of all threads. Returns false if the allocations are
+// not instrumented.
+bool AllocStatsSnapshot(AllocStats& stats);
+
+// Sample every 'every_n'-th allocation of each thread, 0 turns sampling off
+// (which is the default).
+void AllocStatsSetSampleRate(UINT every_n);
+
+// Copies the call sites with the most sampled bytes to 'sites' (in
+// descending order) and returns their number.
+UINT AllocStatsSites(AllocSite* sites, UINT max_sites);
+
+// Writes the statistics and the top call sites as text. A nullptr sink
+// means DbgSinkDebugString.
+bool AllocStatsDump(DBG_SINK_FUNC sink, void* ctx);
+
+#if defined(ROMATO_INSTRUMENT_ALLOCS) && ROMATO_INSTRUMENT_ALLOCS
+// for malloc and free
+void AllocStatsOnAlloc(void* p, size_t size);
+void AllocStatsOnFree(void* p);
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
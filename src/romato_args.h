@@ -34,6 +34,20 @@ int cmdl_to_argv(PTSTR cmdl, PTSTR** ppargv);
 int get_argv(PTSTR** ppargv);
 void free_argv(PTSTR* pargv);
 
+// An argument of a command line that is NOT zero terminated. Arguments that
+// need no unescaping (the common case) point directly into the command line
+// and are not copied, so it has to outlive the views. That is always the case
+// for get_argv_views, which uses the command line of the process.
+typedef struct
+{
+    PCTSTR str;
+    UINT len;
+} ArgView;
+
+int cmdl_to_arg_views(PCTSTR cmdl, ArgView** ppviews);
+int get_argv_views(ArgView** ppviews);
+void free_arg_views(ArgView* pviews);
+
 PTSTR argv_to_cmdl(int argc, PTSTR argv[]);
 void free_cmdl(PTSTR cmdl);
 
@@ -51,16 +51,40 @@ inline void DbgPuts(const char* str)
 void DbgPrintf(const char* fmt, ...);
 void DbgDump(const void* data, size_t len);
 
+#ifdef  __cplusplus
+
+// Receives formatted debug output (traces, dumps, statistics). 'data' is not
+// zero terminated.
+using DBG_SINK_FUNC = void(*)(void* ctx, const char* data, size_t len);
+
+// The default sink, OutputDebugStringA.
+void DbgSinkDebugString(void* ctx, const char* data, size_t len);
+
+// 'ctx' is a file HANDLE.
+void DbgSinkFile(void* ctx, const char* data, size_t len);
+
+#endif // __cplusplus
+
 //////////////////////////////////////////////////////////////////////////////
 
 #if defined(ROMATO_ACTIVATE_TRACES) && ROMATO_ACTIVATE_TRACES
+#if defined(ROMATO_TRACE_RING) && ROMATO_TRACE_RING
+#define TRACE(...) TraceWrite(__VA_ARGS__) // see romato_trace.h
+#else
 #define TRACE(...) DbgPrintf(__VA_ARGS__)
+#endif
 #define TRACE_DUMP(d, l) DbgDump(d, l)
 #else
 #define TRACE(...)
 #define TRACE_DUMP(d, l)
 #endif
 
+#if defined(ROMATO_ACTIVATE_PERF) && ROMATO_ACTIVATE_PERF
+#define PERF_SCOPE(name) PERF_SCOPE_IMPL(name) // see romato_perf.h
+#else
+#define PERF_SCOPE(name)
+#endif
+
 //////////////////////////////////////////////////////////////////////////////
 
 #ifdef _MSC_VER
@@ -0,0 +1,657 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// This file is part of the romato library.
+//
+// Copyright 2013-2026 Rocco Matano
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Declarative command line options.
+//
+// The options are described by a constexpr table of OptSpecT. From that
+// table make_opt_table() builds a perfect hash of the long names at compile
+// time ('hash and displace': the names are distributed to buckets by a first
+// hash, every bucket gets its own seed for a second hash that puts its names
+// into free slots). So looking up an option costs two hashes and one string
+// compare regardless of the number of options. Short names are looked up in a
+// direct table. Parsing needs a single pass over argv and no heap at all:
+// values point into argv, and positional arguments are moved to the front of
+// argv.
+//
+//  constexpr OptSpec g_specs[] =
+//  {
+//      // long name       short   type         enum values       repeatable
+//      { TEXT("verbose"), 'v',    OPT_FLAG,    nullptr,          true },
+//      { TEXT("jobs"),    'j',    OPT_INT },
+//      { TEXT("cache"),   0,      OPT_SIZE },
+//      { TEXT("mode"),    'm',    OPT_ENUM,    TEXT("fast|safe") },
+//      { TEXT("out"),     'o',    OPT_STRING },
+//  };
+//  constexpr auto g_opts = make_opt_table(g_specs);
+//  static_assert(g_opts.valid, "duplicate or invalid option names");
+//
+//  OptResult<TCHAR, ARRAY_SIZE(g_specs)> res;
+//  int npos = g_opts.parse(argc - 1, argv + 1, res);
+//  // res.values[1].num is the value of --jobs, argv[1 .. npos] are the
+//  // positional arguments
+//
+// Accepted syntax: '--name', '--name=value', '--name value', '-n', '-nvalue',
+// '-n value' and bundled flags like '-abc'. '--' ends the options, a lone '-'
+// is a positional argument. Names are case sensitive, enum values are
+// compared ignoring the case of ASCII letters.
+//
+// Value types:
+//  OPT_FLAG    no value, 'count' tells how often it was given
+//  OPT_INT     signed 64 bit, decimal or hexadecimal with '0x' prefix
+//  OPT_SIZE    unsigned 64 bit, optional suffix K, M, G or T (powers of 1024),
+//              which may be followed by 'B' or 'iB'
+//  OPT_ENUM    'num' is the index of the value in 'enum_values' ("a|b|c")
+//  OPT_STRING  just 'str'
+//
+// Options that are not 'repeatable' must not be given more than once.
+// Repeatable options with a value keep the last one.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+enum OptType
+{
+    OPT_FLAG,
+    OPT_INT,
+    OPT_SIZE,
+    OPT_ENUM,
+    OPT_STRING
+};
+
+enum OptError
+{
+    OPT_OK,
+    OPT_ERR_UNKNOWN,
+    OPT_ERR_MISSING_VALUE,
+    OPT_ERR_UNEXPECTED_VALUE,
+    OPT_ERR_BAD_VALUE,
+    OPT_ERR_REPEATED
+};
+
+template <class T> struct OptSpecT
+{
+    const T* long_name;     // may be nullptr
+    T short_name;           // 0 for none, has to be ASCII
+    OptType type;
+    const T* enum_values;
+    bool repeatable;
+};
+
+using OptSpec = OptSpecT<TCHAR>;
+
+template <class T> struct OptValue
+{
+    UINT count;             // number of occurrences
+    INT64 num;              // OPT_INT, OPT_SIZE (as UINT64), OPT_ENUM
+    const T* str;           // the value as given, points into argv
+};
+
+template <class T, UINT N> struct OptResult
+{
+    OptValue<T> values[N];
+    OptError error;
+    int error_arg;          // index into argv of the offending argument
+
+    OptResult() : values{}, error(OPT_OK), error_arg(-1)
+    {
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <class T> constexpr UINT opt_len(const T* str)
+{
+    UINT len = 0;
+    while (str[len])
+    {
+        ++len;
+    }
+    return len;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// FNV-1a, the seed is mixed into the offset basis.
+template <class T> constexpr UINT32 opt_hash(
+    UINT32 seed,
+    const T* str,
+    UINT len
+    )
+{
+    UINT32 hash = 2166136261u ^ seed;
+    for (UINT i = 0; i < len; i++)
+    {
+        hash = (hash ^ static_cast<UINT32>(str[i])) * 16777619u;
+    }
+    // FNV's low bits are weak for short keys
+    return hash ^ (hash >> 15);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <class T> constexpr bool opt_equal(
+    const T* name,
+    const T* str,
+    UINT len
+    )
+{
+    for (UINT i = 0; i < len; i++)
+    {
+        if (name[i] != str[i])
+        {
+            return false;
+        }
+    }
+    return name[len] == 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+constexpr UINT opt_table_size(UINT num)
+{
+    UINT size = 4;
+    while (size < 2 * num)
+    {
+        size *= 2;
+    }
+    return size;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <class T, UINT N> class OptTable
+{
+public:
+
+    static const UINT SIZE = opt_table_size(N);
+    static const UINT BUCKETS = SIZE / 2;
+    static const UINT16 NONE = 0xffff;
+
+    static_assert(N < NONE, "too many options");
+
+    const OptSpecT<T>* specs;
+    UINT16 seeds[BUCKETS];
+    UINT16 slots[SIZE];
+    UINT16 shorts[128];
+    bool valid;
+
+    // Returns the index of the option or -1.
+    constexpr int find_long(const T* name, UINT len) const
+    {
+        const UINT bucket = opt_hash(0, name, len) & (BUCKETS - 1);
+        const UINT32 seed = seeds[bucket];
+        const UINT16 idx = slots[opt_hash(seed, name, len) & (SIZE - 1)];
+        return (
+            idx != NONE && opt_equal(specs[idx].long_name, name, len) ?
+            idx :
+            -1
+            );
+    }
+
+    constexpr int find_short(T c) const
+    {
+        const UINT uc = static_cast<UINT>(c);
+        return (uc < 128 && shorts[uc] != NONE) ? shorts[uc] : -1;
+    }
+
+    // Parses 'argc' arguments (without the program name). Returns the number
+    // of positional arguments, which have been moved to the front of 'argv',
+    // or -1 in case of an error (see 'res.error' and 'res.error_arg').
+    int parse(int argc, T** argv, OptResult<T, N>& res) const;
+
+protected:
+
+    bool set_value(
+        OptResult<T, N>& res,
+        int idx,
+        const T* value,
+        int arg
+        ) const;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <class T, UINT N> constexpr OptTable<T, N> make_opt_table(
+    const OptSpecT<T> (&specs)[N]
+    )
+{
+    OptTable<T, N> table{};
+    table.specs = specs;
+    table.valid = true;
+
+    for (UINT i = 0; i < 128; i++)
+    {
+        table.shorts[i] = OptTable<T, N>::NONE;
+    }
+    for (UINT i = 0; i < N; i++)
+    {
+        const UINT uc = static_cast<UINT>(specs[i].short_name);
+        if (uc)
+        {
+            if (uc >= 128 || table.shorts[uc] != OptTable<T, N>::NONE)
+            {
+                table.valid = false;
+            }
+            else
+            {
+                table.shorts[uc] = static_cast<UINT16>(i);
+            }
+        }
+    }
+
+    using TABLE = OptTable<T, N>;
+    for (UINT i = 0; i < TABLE::SIZE; i++)
+    {
+        table.slots[i] = TABLE::NONE;
+    }
+
+    // first level
+    UINT buckets[N] = {};
+    UINT bucket_size[TABLE::BUCKETS] = {};
+    for (UINT i = 0; i < N; i++)
+    {
+        const T* name = specs[i].long_name;
+        if (name)
+        {
+            buckets[i] = (
+                opt_hash(0, name, opt_len(name)) &
+                (TABLE::BUCKETS - 1)
+                );
+            ++bucket_size[buckets[i]];
+        }
+    }
+
+    // Place the largest buckets first, while there are still many free
+    // slots. Seeds start at 1, because seed 0 is the first level hash.
+    for (;;)
+    {
+        UINT bucket = 0;
+        for (UINT b = 1; b < TABLE::BUCKETS; b++)
+        {
+            if (bucket_size[b] > bucket_size[bucket])
+            {
+                bucket = b;
+            }
+        }
+        if (bucket_size[bucket] == 0)
+        {
+            return table;
+        }
+
+        bool done = false;
+        for (UINT32 seed = 1; seed < TABLE::NONE && !done; seed++)
+        {
+            UINT slots[N] = {};
+            UINT num = 0;
+            done = true;
+            for (UINT i = 0; i < N && done; i++)
+            {
+                const T* name = specs[i].long_name;
+                if (!name || buckets[i] != bucket)
+                {
+                    continue;
+                }
+                const UINT slot = (
+                    opt_hash(seed, name, opt_len(name)) &
+                    (TABLE::SIZE - 1)
+                    );
+                done = table.slots[slot] == TABLE::NONE;
+                for (UINT k = 0; k < num && done; k++)
+                {
+                    done = slots[k] != slot;
+                }
+                slots[num++] = slot;
+            }
+            if (done)
+            {
+                UINT k = 0;
+                for (UINT i = 0; i < N; i++)
+                {
+                    if (specs[i].long_name && buckets[i] == bucket)
+                    {
+                        table.slots[slots[k++]] = static_cast<UINT16>(i);
+                    }
+                }
+                table.seeds[bucket] = static_cast<UINT16>(seed);
+            }
+        }
+        if (!done)
+        {
+            // duplicate names
+            break;
+        }
+        bucket_size[bucket] = 0;
+    }
+    table.valid = false;
+    return table;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <class T> bool opt_parse_int(const T* str, INT64& value)
+{
+    bool neg = false;
+    if (*str == T('-') || *str == T('+'))
+    {
+        neg = (*str++ == T('-'));
+    }
+    UINT64 base = 10;
+    if (str[0] == T('0') && (str[1] == T('x') || str[1] == T('X')))
+    {
+        base = 16;
+        str += 2;
+    }
+    if (!*str)
+    {
+        return false;
+    }
+
+    const UINT64 limit = neg ? 0x8000000000000000ull : 0x7fffffffffffffffull;
+    UINT64 acc = 0;
+    for (; *str; ++str)
+    {
+        UINT64 digit;
+        const UINT c = static_cast<UINT>(*str);
+        if (c >= '0' && c <= '9')
+        {
+            digit = c - '0';
+        }
+        else if (base == 16 && (c | 0x20) >= 'a' && (c | 0x20) <= 'f')
+        {
+            digit = (c | 0x20) - 'a' + 10;
+        }
+        else
+        {
+            return false;
+        }
+        if (acc > (limit - digit) / base)
+        {
+            return false;
+        }
+        acc = acc * base + digit;
+    }
+    value = neg ? static_cast<INT64>(0 - acc) : static_cast<INT64>(acc);
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <class T> bool opt_parse_size(const T* str, UINT64& value)
+{
+    UINT64 acc = 0;
+    const T* start = str;
+    for (; *str >= T('0') && *str <= T('9'); ++str)
+    {
+        const UINT64 digit = static_cast<UINT64>(*str - T('0'));
+        if (acc > (~0ull - digit) / 10)
+        {
+            return false;
+        }
+        acc = acc * 10 + digit;
+    }
+    if (str == start)
+    {
+        return false;
+    }
+
+    UINT shift = 0;
+    switch (static_cast<UINT>(*str) | 0x20)
+    {
+        case 'k': shift = 10; break;
+        case 'm': shift = 20; break;
+        case 'g': shift = 30; break;
+        case 't': shift = 40; break;
+    }
+    if (shift)
+    {
+        ++str;
+        if ((static_cast<UINT>(*str) | 0x20) == 'i')
+        {
+            ++str;
+            if ((static_cast<UINT>(*str) | 0x20) != 'b')
+            {
+                return false;
+            }
+        }
+    }
+    if ((static_cast<UINT>(*str) | 0x20) == 'b')
+    {
+        ++str;
+    }
+    if (*str || acc > (~0ull >> shift))
+    {
+        return false;
+    }
+    value = acc << shift;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <class T> bool opt_parse_enum(
+    const T* values,
+    const T* str,
+    INT64& value
+    )
+{
+    auto lower = [](UINT c) { return (c >= 'A' && c <= 'Z') ? c | 0x20 : c; };
+    INT64 idx = 0;
+    for (;;)
+    {
+        const T* s = str;
+        while (
+            *values &&
+            *values != T('|') &&
+            *s &&
+            lower(static_cast<UINT>(*values)) == lower(static_cast<UINT>(*s))
+            )
+        {
+            ++values;
+            ++s;
+        }
+        if ((*values == 0 || *values == T('|')) && *s == 0)
+        {
+            value = idx;
+            return true;
+        }
+        while (*values && *values != T('|'))
+        {
+            ++values;
+        }
+        if (*values == 0)
+        {
+            return false;
+        }
+        ++values;
+        ++idx;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <class T, UINT N> bool OptTable<T, N>::set_value(
+    OptResult<T, N>& res,
+    int idx,
+    const T* value,
+    int arg
+    ) const
+{
+    const OptSpecT<T>& spec = specs[idx];
+    OptValue<T>& val = res.values[idx];
+    OptError err = OPT_OK;
+    if (val.count && !spec.repeatable)
+    {
+        err = OPT_ERR_REPEATED;
+    }
+    else if (spec.type == OPT_FLAG)
+    {
+        if (value)
+        {
+            err = OPT_ERR_UNEXPECTED_VALUE;
+        }
+    }
+    else if (!value)
+    {
+        err = OPT_ERR_MISSING_VALUE;
+    }
+    else
+    {
+        bool ok = true;
+        switch (spec.type)
+        {
+            case OPT_INT:
+                ok = opt_parse_int(value, val.num);
+                break;
+
+            case OPT_SIZE:
+            {
+                UINT64 size = 0;
+                ok = opt_parse_size(value, size);
+                val.num = static_cast<INT64>(size);
+                break;
+            }
+
+            case OPT_ENUM:
+                ok = opt_parse_enum(spec.enum_values, value, val.num);
+                break;
+
+            default:
+                break;
+        }
+        if (!ok)
+        {
+            err = OPT_ERR_BAD_VALUE;
+        }
+        val.str = value;
+    }
+
+    if (err != OPT_OK)
+    {
+        res.error = err;
+        res.error_arg = arg;
+        return false;
+    }
+    ++val.count;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <class T, UINT N> int OptTable<T, N>::parse(
+    int argc,
+    T** argv,
+    OptResult<T, N>& res
+    ) const
+{
+    int npos = 0;
+    int arg = 0;
+    for (; arg < argc; arg++)
+    {
+        T* str = argv[arg];
+        if (str[0] != T('-') || str[1] == 0)
+        {
+            argv[npos++] = str;
+            continue;
+        }
+
+        if (str[1] == T('-'))
+        {
+            if (str[2] == 0)
+            {
+                // end of options
+                ++arg;
+                break;
+            }
+            const T* name = str + 2;
+            UINT len = 0;
+            while (name[len] && name[len] != T('='))
+            {
+                ++len;
+            }
+            const int idx = find_long(name, len);
+            if (idx < 0)
+            {
+                res.error = OPT_ERR_UNKNOWN;
+                res.error_arg = arg;
+                return -1;
+            }
+            const T* value = name[len] ? name + len + 1 : nullptr;
+            const int opt_arg = arg;
+            if (!value && specs[idx].type != OPT_FLAG && arg + 1 < argc)
+            {
+                value = argv[++arg];
+            }
+            if (!set_value(res, idx, value, opt_arg))
+            {
+                return -1;
+            }
+            continue;
+        }
+
+        // one or more short options
+        for (const T* p = str + 1; *p; ++p)
+        {
+            const int idx = find_short(*p);
+            if (idx < 0)
+            {
+                res.error = OPT_ERR_UNKNOWN;
+                res.error_arg = arg;
+                return -1;
+            }
+            if (specs[idx].type == OPT_FLAG)
+            {
+                if (!set_value(res, idx, nullptr, arg))
+                {
+                    return -1;
+                }
+                continue;
+            }
+            const T* value = p[1] ? p + 1 : nullptr;
+            const int opt_arg = arg;
+            if (!value && arg + 1 < argc)
+            {
+                value = argv[++arg];
+            }
+            if (!set_value(res, idx, value, opt_arg))
+            {
+                return -1;
+            }
+            break;
+        }
+    }
+
+    // everything after '--'
+    for (; arg < argc; arg++)
+    {
+        argv[npos++] = argv[arg];
+    }
+    return npos;
+}
+
+////////////////////////////////////////////////////////////////////////////////
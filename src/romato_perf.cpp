@@ -0,0 +1,383 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// This file is part of the romato library.
+//
+// Copyright 2013-2026 Rocco Matano
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "romato.h"
+#include "romato_perf.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Intentionally no objects with constructors, because static constructors
+// are only executed if ROMATO_CONSTRUCT_STATIC_OBJECTS is set.
+static std::atomic<PerfSite*> s_sites;
+static SRWLOCK s_register_lock = SRWLOCK_INIT;
+static INIT_ONCE s_init_once = INIT_ONCE_STATIC_INIT;
+static UINT64 s_tsc0;
+static UINT64 s_qpc0;
+
+////////////////////////////////////////////////////////////////////////////////
+
+static BOOL CALLBACK InitPerf(INIT_ONCE*, void*, void**)
+{
+    LARGE_INTEGER qpc;
+    QueryPerformanceCounter(&qpc);
+    s_qpc0 = qpc.QuadPart;
+    s_tsc0 = __rdtsc();
+    return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void PerfSite::register_site()
+{
+    InitOnceExecuteOnce(&s_init_once, InitPerf, nullptr, nullptr);
+
+    // Sites are only ever added, never removed. m_next is written before the
+    // site gets published and does not change afterwards, so the list can be
+    // walked without holding the lock.
+    AcquireSRWLockExclusive(&s_register_lock);
+    if (!m_registered.load(std::memory_order_relaxed))
+    {
+        m_next = s_sites.load(std::memory_order_relaxed);
+        s_sites.store(this, std::memory_order_release);
+        m_registered.store(true, std::memory_order_release);
+    }
+    ReleaseSRWLockExclusive(&s_register_lock);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void PerfSite::snapshot(Snapshot& snap) const
+{
+    snap.name = m_name;
+    snap.sum = m_sum.load(std::memory_order_relaxed);
+    snap.min = m_min.load(std::memory_order_relaxed);
+    snap.max = m_max.load(std::memory_order_relaxed);
+
+    // There is no separate counter, the count is the sum of the buckets.
+    snap.count = 0;
+    for (UINT i = 0; i < PERF_NUM_BUCKETS; i++)
+    {
+        snap.buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+        snap.count += snap.buckets[i];
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void PerfSite::reset()
+{
+    for (auto& bucket : m_buckets)
+    {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    m_sum.store(0, std::memory_order_relaxed);
+    m_min.store(~UINT64(0), std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+UINT64 PerfSite::Snapshot::percentile(UINT permille) const
+{
+    if (!count)
+    {
+        return 0;
+    }
+    const UINT64 target = (count * permille + 999) / 1000;
+    UINT64 seen = 0;
+    for (UINT i = 0; i < PERF_NUM_BUCKETS; i++)
+    {
+        seen += buckets[i];
+        if (seen >= target && seen)
+        {
+            // report the upper edge of the bucket, but never more than the
+            // maximum that was actually seen
+            const UINT64 upper = (
+                i + 1 < PERF_NUM_BUCKETS ? PerfBucketFloor(i + 1) - 1 : max
+                );
+            return upper < max ? upper : max;
+        }
+    }
+    return max;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+UINT64 PerfTicksPerSecond()
+{
+    LARGE_INTEGER freq;
+    QueryPerformanceFrequency(&freq);
+#if defined(ROMATO_PERF_USE_QPC) && ROMATO_PERF_USE_QPC
+    return freq.QuadPart;
+#else
+    InitOnceExecuteOnce(&s_init_once, InitPerf, nullptr, nullptr);
+
+    // Calibrate against QPC. If the process did not run long enough for a
+    // reasonable precision, wait a little.
+    LARGE_INTEGER qpc;
+    QueryPerformanceCounter(&qpc);
+    if (static_cast<UINT64>(qpc.QuadPart) - s_qpc0 < freq.QuadPart / 20)
+    {
+        Sleep(50);
+        QueryPerformanceCounter(&qpc);
+    }
+    const UINT64 tsc_delta = __rdtsc() - s_tsc0;
+    const UINT64 qpc_delta = qpc.QuadPart - s_qpc0;
+    if (!qpc_delta)
+    {
+        return freq.QuadPart;
+    }
+    // split to avoid overflow
+    return (
+        tsc_delta / qpc_delta * freq.QuadPart +
+        tsc_delta % qpc_delta * freq.QuadPart / qpc_delta
+        );
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+UINT64 PerfTicksToNs(UINT64 ticks, UINT64 ticks_per_sec)
+{
+    const UINT64 ns_per_sec = 1000000000;
+    if (!ticks_per_sec)
+    {
+        return 0;
+    }
+    return (
+        ticks / ticks_per_sec * ns_per_sec +
+        ticks % ticks_per_sec * ns_per_sec / ticks_per_sec
+        );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// Collects the output in a buffer and hands it to the sink in chunks.
+class PerfWriter
+{
+public:
+
+    PerfWriter(DBG_SINK_FUNC sink, void* ctx) :
+        m_sink(sink ? sink : DbgSinkDebugString),
+        m_ctx(ctx),
+        m_len(0)
+    {
+    }
+
+    ~PerfWriter()
+    {
+        flush();
+    }
+
+    PerfWriter(const PerfWriter&) = delete;
+    PerfWriter& operator=(const PerfWriter&) = delete;
+
+    void printf(const char* fmt, ...)
+    {
+        va_list args;
+        va_start(args, fmt);
+        UINT avail = sizeof(m_buf) - m_len;
+        int res = sz_vnprintfA(m_buf + m_len, avail, fmt, args);
+        va_end(args);
+        if (res >= static_cast<int>(avail))
+        {
+            // Did not fit, flush and try again with the whole buffer. If
+            // it still does not fit, the line gets truncated.
+            flush();
+            va_start(args, fmt);
+            avail = sizeof(m_buf);
+            res = sz_vnprintfA(m_buf, avail, fmt, args);
+            va_end(args);
+            if (res >= static_cast<int>(avail))
+            {
+                res = avail - 1;
+            }
+        }
+        if (res > 0)
+        {
+            m_len += res;
+        }
+    }
+
+    void flush()
+    {
+        if (m_len)
+        {
+            m_sink(m_ctx, m_buf, m_len);
+            m_len = 0;
+        }
+    }
+
+protected:
+    DBG_SINK_FUNC m_sink;
+    void* m_ctx;
+    UINT m_len;
+    char m_buf[4096];
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Copies 'name' while escaping characters that are special in JSON.
+void JsonEscape(const char* name, char* buf, UINT size)
+{
+    UINT len = 0;
+    for (; *name && len + 2 < size; name++)
+    {
+        const char c = *name;
+        if (c == '"' || c == '\\')
+        {
+            buf[len++] = '\\';
+            buf[len++] = c;
+        }
+        else
+        {
+            buf[len++] = static_cast<unsigned char>(c) < ' ' ? ' ' : c;
+        }
+    }
+    buf[len] = 0;
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool PerfDumpText(DBG_SINK_FUNC sink, void* ctx)
+{
+    PerfSite* site = s_sites.load(std::memory_order_acquire);
+    if (!site)
+    {
+        return false;
+    }
+
+    const UINT64 tps = PerfTicksPerSecond();
+    PerfWriter out(sink, ctx);
+    out.printf(
+        "%-32s %10s %10s %10s %10s %10s %10s %10s %10s\n",
+        "site [ns]",
+        "count",
+        "min",
+        "mean",
+        "p50",
+        "p90",
+        "p99",
+        "p99.9",
+        "max"
+        );
+
+    auto snap = static_cast<PerfSite::Snapshot*>(
+        malloc(sizeof(PerfSite::Snapshot))
+        );
+    for (; site; site = site->next())
+    {
+        site->snapshot(*snap);
+        if (!snap->count)
+        {
+            continue;
+        }
+        out.printf(
+            "%-32s %10llu %10llu %10llu %10llu %10llu %10llu %10llu %10llu\n",
+            snap->name,
+            snap->count,
+            PerfTicksToNs(snap->min, tps),
+            PerfTicksToNs(snap->sum / snap->count, tps),
+            PerfTicksToNs(snap->percentile(500), tps),
+            PerfTicksToNs(snap->percentile(900), tps),
+            PerfTicksToNs(snap->percentile(990), tps),
+            PerfTicksToNs(snap->percentile(999), tps),
+            PerfTicksToNs(snap->max, tps)
+            );
+    }
+    free(snap);
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool PerfDumpChromeTrace(DBG_SINK_FUNC sink, void* ctx)
+{
+    PerfSite* site = s_sites.load(std::memory_order_acquire);
+    if (!site)
+    {
+        return false;
+    }
+
+    // One counter event per site. The viewers show each of them as a track
+    // with the percentiles as series.
+    const UINT64 tps = PerfTicksPerSecond();
+    PerfWriter out(sink, ctx);
+    out.printf("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+
+    auto snap = static_cast<PerfSite::Snapshot*>(
+        malloc(sizeof(PerfSite::Snapshot))
+        );
+    char name[256];
+    const char* sep = "";
+    for (; site; site = site->next())
+    {
+        site->snapshot(*snap);
+        if (!snap->count)
+        {
+            continue;
+        }
+        JsonEscape(snap->name, name, sizeof(name));
+        out.printf(
+            "%s{\"name\":\"%s\",\"ph\":\"C\",\"ts\":0,\"pid\":%u,\"tid\":0,"
+            "\"args\":{\"count\":%llu,\"min_ns\":%llu,\"mean_ns\":%llu,"
+            "\"p50_ns\":%llu,\"p90_ns\":%llu,\"p99_ns\":%llu,"
+            "\"p999_ns\":%llu,\"max_ns\":%llu}}",
+            sep,
+            name,
+            GetCurrentProcessId(),
+            snap->count,
+            PerfTicksToNs(snap->min, tps),
+            PerfTicksToNs(snap->sum / snap->count, tps),
+            PerfTicksToNs(snap->percentile(500), tps),
+            PerfTicksToNs(snap->percentile(900), tps),
+            PerfTicksToNs(snap->percentile(990), tps),
+            PerfTicksToNs(snap->percentile(999), tps),
+            PerfTicksToNs(snap->max, tps)
+            );
+        sep = ",\n";
+    }
+    free(snap);
+    out.printf("\n]}\n");
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void PerfReset()
+{
+    PerfSite* site = s_sites.load(std::memory_order_acquire);
+    for (; site; site = site->next())
+    {
+        site->reset();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
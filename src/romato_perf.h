@@ -0,0 +1,269 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// This file is part of the romato library.
+//
+// Copyright 2013-2026 Rocco Matano
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <intrin.h>
+#include "container.h"
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Scoped timers for hot paths.
+//
+// PERF_SCOPE("name") measures the time until the end of the enclosing scope
+// and adds it to a latency histogram that belongs to this call site. The
+// histograms are log-linear (16 linear sub-buckets per power of two, i.e.
+// a relative error of at most 1/16) and are updated with relaxed atomic
+// increments, so timed code on different threads never blocks.
+//
+// Time is measured with rdtsc, or with QueryPerformanceCounter if
+// ROMATO_PERF_USE_QPC is set. Ticks are converted to nanoseconds only when
+// the histograms are dumped.
+//
+// PerfDumpText() writes a table with count and percentiles per site,
+// PerfDumpChromeTrace() writes JSON in the Chrome trace event format (one
+// counter event per site) that can be loaded into chrome://tracing or
+// Perfetto.
+//
+// Like TRACE, PERF_SCOPE compiles to nothing unless ROMATO_ACTIVATE_PERF is
+// set. In that case romato.h also includes this file.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+const UINT PERF_SUB_BITS = 4;
+const UINT PERF_SUB_BUCKETS = 1 << PERF_SUB_BITS;
+
+// Durations of 2^48 ticks or more (about a day) all end up in the last
+// bucket.
+const UINT PERF_MAX_BITS = 48;
+const UINT PERF_NUM_BUCKETS = (
+    (PERF_MAX_BITS - PERF_SUB_BITS + 1) << PERF_SUB_BITS
+    );
+
+inline UINT PerfBucket(UINT64 ticks)
+{
+    if (ticks < PERF_SUB_BUCKETS)
+    {
+        return static_cast<UINT>(ticks);
+    }
+    if (ticks >> PERF_MAX_BITS)
+    {
+        return PERF_NUM_BUCKETS - 1;
+    }
+    unsigned long msb;
+#ifdef _WIN64
+    _BitScanReverse64(&msb, ticks);
+#else
+    if (ticks >> 32)
+    {
+        _BitScanReverse(&msb, static_cast<ULONG>(ticks >> 32));
+        msb += 32;
+    }
+    else
+    {
+        _BitScanReverse(&msb, static_cast<ULONG>(ticks));
+    }
+#endif
+    const UINT shift = msb - PERF_SUB_BITS;
+    const UINT sub = static_cast<UINT>(ticks >> shift) & (PERF_SUB_BUCKETS - 1);
+    return ((shift + 1) << PERF_SUB_BITS) + sub;
+}
+
+// smallest number of ticks that falls into 'bucket'
+inline UINT64 PerfBucketFloor(UINT bucket)
+{
+    if (bucket < PERF_SUB_BUCKETS)
+    {
+        return bucket;
+    }
+    const UINT shift = (bucket >> PERF_SUB_BITS) - 1;
+    const UINT64 sub = bucket & (PERF_SUB_BUCKETS - 1);
+    return (PERF_SUB_BUCKETS + sub) << shift;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+inline UINT64 PerfNow()
+{
+#if defined(ROMATO_PERF_USE_QPC) && ROMATO_PERF_USE_QPC
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    return now.QuadPart;
+#else
+    return __rdtsc();
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// One per call site. Has a constexpr constructor, so that function local
+// statics of this type are initialized at compile time and need neither a
+// static constructor nor a thread safe initialization guard. The site links
+// itself into the global list the first time it records a duration.
+
+class PerfSite
+{
+public:
+
+    constexpr explicit PerfSite(const char* name) :
+        m_name(name),
+        m_next(nullptr),
+        m_registered(false),
+        m_sum(0),
+        m_min(~UINT64(0)),
+        m_max(0),
+        m_buckets{}
+    {
+    }
+
+    PerfSite(const PerfSite&) = delete;
+    PerfSite& operator=(const PerfSite&) = delete;
+
+    void record(UINT64 ticks)
+    {
+        if (!m_registered.load(std::memory_order_acquire))
+        {
+            register_site();
+        }
+        m_buckets[PerfBucket(ticks)].fetch_add(1, std::memory_order_relaxed);
+        m_sum.fetch_add(ticks, std::memory_order_relaxed);
+        update_min(ticks);
+        update_max(ticks);
+    }
+
+    // PerfDumpText and friends work on snapshots of the sites
+    struct Snapshot
+    {
+        const char* name;
+        UINT64 count;
+        UINT64 sum;
+        UINT64 min;
+        UINT64 max;
+        UINT64 buckets[PERF_NUM_BUCKETS];
+
+        // smallest duration (in ticks) that is not exceeded by 'permille'
+        // of the samples
+        UINT64 percentile(UINT permille) const;
+    };
+
+    void snapshot(Snapshot& snap) const;
+    void reset();
+
+    PerfSite* next() const
+    {
+        return m_next;
+    }
+
+protected:
+
+    void register_site();
+
+    void update_min(UINT64 ticks)
+    {
+        UINT64 cur = m_min.load(std::memory_order_relaxed);
+        while (
+            ticks < cur &&
+            !m_min.compare_exchange_weak(
+                cur,
+                ticks,
+                std::memory_order_relaxed
+                )
+            );
+    }
+
+    void update_max(UINT64 ticks)
+    {
+        UINT64 cur = m_max.load(std::memory_order_relaxed);
+        while (
+            ticks > cur &&
+            !m_max.compare_exchange_weak(
+                cur,
+                ticks,
+                std::memory_order_relaxed
+                )
+            );
+    }
+
+    const char* m_name;
+    PerfSite* m_next;
+    std::atomic<bool> m_registered;
+    std::atomic<UINT64> m_sum;
+    std::atomic<UINT64> m_min;
+    std::atomic<UINT64> m_max;
+    std::atomic<UINT64> m_buckets[PERF_NUM_BUCKETS];
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+class PerfScope
+{
+public:
+
+    explicit PerfScope(PerfSite& site) : m_site(site), m_start(PerfNow())
+    {
+    }
+
+    ~PerfScope()
+    {
+        m_site.record(PerfNow() - m_start);
+    }
+
+    PerfScope(const PerfScope&) = delete;
+    PerfScope& operator=(const PerfScope&) = delete;
+
+protected:
+    PerfSite& m_site;
+    UINT64 m_start;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Conversion of ticks to nanoseconds. For rdtsc the frequency is derived
+// from QueryPerformanceCounter over the time since the first site was
+// registered, so it gets more precise the longer the process runs.
+UINT64 PerfTicksPerSecond();
+UINT64 PerfTicksToNs(UINT64 ticks, UINT64 ticks_per_sec);
+
+// Both return false if no site recorded anything yet. A nullptr sink means
+// DbgSinkDebugString.
+bool PerfDumpText(DBG_SINK_FUNC sink, void* ctx);
+bool PerfDumpChromeTrace(DBG_SINK_FUNC sink, void* ctx);
+
+// Clear the histograms of all sites.
+void PerfReset();
+
+////////////////////////////////////////////////////////////////////////////////
+
+// PERF_SCOPE itself is defined in romato_debug.h
+
+#define PERF_CAT2(a, b) a##b
+#define PERF_CAT(a, b) PERF_CAT2(a, b)
+
+#define PERF_SCOPE_IMPL(name) \
+    static PerfSite PERF_CAT(s_perf_site_, __LINE__)(name); \
+    PerfScope PERF_CAT(perf_scope_, __LINE__)(PERF_CAT(s_perf_site_, __LINE__))
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,120 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// This file is part of the romato library.
+//
+// Copyright 2013-2026 Rocco Matano
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <intrin.h>
+#include <emmintrin.h>
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// SSE2 helpers for scanning zero terminated strings of 8 or 16 bit
+// characters.
+//
+// simd_find() reads 16 byte aligned blocks only. Such a block never crosses a
+// page boundary, so reading past the terminating zero is harmless. The string
+// has to be aligned to the size of its characters (as every string coming
+// from the heap or the system is).
+//
+////////////////////////////////////////////////////////////////////////////////
+
+template <size_t N> struct SimdLanes;
+
+template <> struct SimdLanes<1>
+{
+    static __m128i set1(UINT c)
+    {
+        return _mm_set1_epi8(static_cast<char>(c));
+    }
+
+    static __m128i eq(__m128i a, __m128i b)
+    {
+        return _mm_cmpeq_epi8(a, b);
+    }
+};
+
+template <> struct SimdLanes<2>
+{
+    static __m128i set1(UINT c)
+    {
+        return _mm_set1_epi16(static_cast<short>(c));
+    }
+
+    static __m128i eq(__m128i a, __m128i b)
+    {
+        return _mm_cmpeq_epi16(a, b);
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Lane mask of the characters in 'v' that are equal to 'c'.
+template <class T> inline __m128i simd_eq(__m128i v, T c)
+{
+    return SimdLanes<sizeof(T)>::eq(v, SimdLanes<sizeof(T)>::set1(c));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Returns a pointer to the first character of 'str' for which 'pred' is true
+// or to the terminating zero. 'pred' gets 16 bytes of characters and has to
+// return a lane mask (e.g. the result of simd_eq).
+template <class T, class PRED> const T* simd_find(const T* str, PRED pred)
+{
+    const uintptr_t addr = p2i<uintptr_t>(str);
+    auto blk = i2p<const __m128i*>(addr & ~static_cast<uintptr_t>(15));
+    const __m128i zero = _mm_setzero_si128();
+
+    // ignore the bytes in front of 'str' in the first block
+    UINT mask = 0xffffU << (addr & 15);
+    for (;;)
+    {
+        const __m128i v = _mm_load_si128(blk);
+        const __m128i hit = _mm_or_si128(
+            SimdLanes<sizeof(T)>::eq(v, zero),
+            pred(v)
+            );
+        const UINT bits = _mm_movemask_epi8(hit) & mask;
+        if (bits)
+        {
+            unsigned long idx;
+            _BitScanForward(&idx, bits);
+            return i2p<const T*>(p2i<uintptr_t>(blk) + idx);
+        }
+        mask = 0xffffU;
+        ++blk;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <class T> inline UINT simd_len(const T* str)
+{
+    const T* end = simd_find(str, [](__m128i) { return _mm_setzero_si128(); });
+    return static_cast<UINT>(end - str);
+}
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,323 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// This file is part of the romato library.
+//
+// Copyright 2013-2026 Rocco Matano
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "romato.h"
+#include "romato_trace.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Intentionally no objects with constructors, because static constructors
+// are only executed if ROMATO_CONSTRUCT_STATIC_OBJECTS is set.
+std::atomic<DWORD> g_trace_tls(TLS_OUT_OF_INDEXES);
+static std::atomic<TraceThread*> s_threads;
+static std::atomic<size_t> s_capacity(1024);
+static INIT_ONCE s_init_once = INIT_ONCE_STATIC_INIT;
+static UINT64 s_tsc0;
+static UINT64 s_qpc0;
+static SRWLOCK s_drain_lock = SRWLOCK_INIT;
+
+static HANDLE s_drain_thread;
+static HANDLE s_drain_stop;
+static UINT s_drain_interval;
+static DBG_SINK_FUNC s_drain_sink;
+static void* s_drain_ctx;
+
+////////////////////////////////////////////////////////////////////////////////
+
+static BOOL CALLBACK InitTrace(INIT_ONCE*, void*, void**)
+{
+    LARGE_INTEGER qpc;
+    QueryPerformanceCounter(&qpc);
+    s_qpc0 = qpc.QuadPart;
+    s_tsc0 = __rdtsc();
+    g_trace_tls.store(TlsAlloc(), std::memory_order_relaxed);
+    return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+TraceThread* TraceCreateThread()
+{
+    InitOnceExecuteOnce(&s_init_once, InitTrace, nullptr, nullptr);
+
+    // The ring of a thread stays alive until the process ends, so that its
+    // events can still be drained after the thread exited.
+    auto self = new TraceThread(s_capacity.load(std::memory_order_relaxed));
+    TraceThread* head = s_threads.load(std::memory_order_relaxed);
+    do
+    {
+        self->next = head;
+    }
+    while (!s_threads.compare_exchange_weak(
+        head,
+        self,
+        std::memory_order_release,
+        std::memory_order_relaxed
+        ));
+
+    const DWORD err = GetLastError();
+    TlsSetValue(g_trace_tls.load(std::memory_order_relaxed), self);
+    SetLastError(err);
+    return self;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void TraceSetRingCapacity(size_t capacity)
+{
+    if (capacity < 2 || !IS_POW_2(capacity))
+    {
+        RaiseException(E_INVALIDARG);
+    }
+    s_capacity.store(capacity, std::memory_order_relaxed);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+static int FormatEvent(
+    char* buf,
+    UINT size,
+    TraceEvent& evt,
+    DWORD thread_id,
+    UINT64 ticks_per_us
+    )
+{
+    const UINT64 ticks = evt.tsc > s_tsc0 ? evt.tsc - s_tsc0 : 0;
+    const UINT64 us = ticks / ticks_per_us;
+    int len = sz_nprintfA(
+        buf,
+        size,
+        "%6llu.%06u [%5u] ",
+        us / 1000000,
+        static_cast<UINT>(us % 1000000),
+        thread_id
+        );
+
+    // Turn the string offsets into pointers and the argument image into a
+    // va_list.
+    static const WCHAR empty[1] = {0};
+    for (UINT i = 0; i < evt.num_str; i++)
+    {
+        uintptr_t offset;
+        memcpy(&offset, evt.args + evt.str_slot[i], sizeof(offset));
+        const void* str = (
+            offset < TRACE_STR_SPACE ?
+            static_cast<const void*>(evt.strs + offset) :
+            static_cast<const void*>(empty)
+            );
+        memcpy(evt.args + evt.str_slot[i], &str, sizeof(str));
+    }
+    va_list args = p2p<va_list>(evt.args);
+    const int res = sz_vnprintfA(buf + len, size - len, evt.fmt, args);
+    len += res;
+    return len < static_cast<int>(size) ? len : size - 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+static UINT64 TicksPerMicrosecond()
+{
+    LARGE_INTEGER qpc;
+    LARGE_INTEGER freq;
+    QueryPerformanceCounter(&qpc);
+    QueryPerformanceFrequency(&freq);
+    const UINT64 tsc = __rdtsc();
+    const UINT64 qpc_delta = qpc.QuadPart - s_qpc0;
+    if (!qpc_delta || tsc <= s_tsc0)
+    {
+        return 1;
+    }
+
+    // ticks per second, split to avoid overflow
+    const UINT64 tsc_delta = tsc - s_tsc0;
+    const UINT64 per_sec = (
+        tsc_delta / qpc_delta * freq.QuadPart +
+        tsc_delta % qpc_delta * freq.QuadPart / qpc_delta
+        );
+    return per_sec >= 1000000 ? per_sec / 1000000 : 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Has to be called with s_drain_lock held.
+static void DrainLocked(DBG_SINK_FUNC sink, void* ctx)
+{
+    if (!sink)
+    {
+        sink = DbgSinkDebugString;
+    }
+    const UINT64 ticks_per_us = TicksPerMicrosecond();
+    char buf[1024];
+
+    // Events that are recorded while draining are left for the next time,
+    // otherwise a busy thread could keep the drain going forever.
+    TraceThread* const first = s_threads.load(std::memory_order_acquire);
+    size_t budget = 0;
+    for (TraceThread* t = first; t; t = t->next)
+    {
+        budget += t->ring.size_approx() + t->has_pending;
+    }
+
+    // merge by time stamp
+    for (; budget; budget--)
+    {
+        TraceThread* oldest = nullptr;
+        for (TraceThread* t = first; t; t = t->next)
+        {
+            if (!t->has_pending)
+            {
+                t->has_pending = t->ring.try_pop(t->pending);
+            }
+            if (
+                t->has_pending &&
+                (!oldest || t->pending.tsc < oldest->pending.tsc)
+                )
+            {
+                oldest = t;
+            }
+        }
+        if (!oldest)
+        {
+            break;
+        }
+        const int len = FormatEvent(
+            buf,
+            sizeof(buf),
+            oldest->pending,
+            oldest->thread_id,
+            ticks_per_us
+            );
+        oldest->has_pending = false;
+        sink(ctx, buf, len);
+    }
+
+    for (TraceThread* t = first; t; t = t->next)
+    {
+        const UINT64 dropped = t->dropped.exchange(
+            0,
+            std::memory_order_relaxed
+            );
+        if (dropped)
+        {
+            const int len = sz_nprintfA(
+                buf,
+                sizeof(buf),
+                "trace: thread %u dropped %llu events\n",
+                t->thread_id,
+                dropped
+                );
+            sink(ctx, buf, len);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void TraceDrain(DBG_SINK_FUNC sink, void* ctx)
+{
+    AcquireSRWLockExclusive(&s_drain_lock);
+    DrainLocked(sink, ctx);
+    ReleaseSRWLockExclusive(&s_drain_lock);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool TraceDumpAll(DBG_SINK_FUNC sink, void* ctx)
+{
+    for (int i = 0; !TryAcquireSRWLockExclusive(&s_drain_lock); i++)
+    {
+        if (i == 100)
+        {
+            return false;
+        }
+        Sleep(1);
+    }
+    DrainLocked(sink, ctx);
+    ReleaseSRWLockExclusive(&s_drain_lock);
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+static DWORD WINAPI DrainThreadProc(void*)
+{
+    while (WaitForSingleObject(s_drain_stop, s_drain_interval) == WAIT_TIMEOUT)
+    {
+        TraceDrain(s_drain_sink, s_drain_ctx);
+    }
+    TraceDrain(s_drain_sink, s_drain_ctx);
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool TraceStartDrainThread(UINT interval_ms, DBG_SINK_FUNC sink, void* ctx)
+{
+    if (s_drain_thread)
+    {
+        return false;
+    }
+    s_drain_interval = interval_ms;
+    s_drain_sink = sink;
+    s_drain_ctx = ctx;
+    s_drain_stop = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    if (!s_drain_stop)
+    {
+        return false;
+    }
+    s_drain_thread = CreateThread(
+        nullptr,
+        0,
+        DrainThreadProc,
+        nullptr,
+        0,
+        nullptr
+        );
+    if (!s_drain_thread)
+    {
+        CloseHandle(s_drain_stop);
+        s_drain_stop = nullptr;
+        return false;
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void TraceStopDrainThread()
+{
+    if (s_drain_thread)
+    {
+        SetEvent(s_drain_stop);
+        WaitForSingleObject(s_drain_thread, INFINITE);
+        CloseHandle(s_drain_thread);
+        CloseHandle(s_drain_stop);
+        s_drain_thread = nullptr;
+        s_drain_stop = nullptr;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
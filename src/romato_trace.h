@@ -0,0 +1,278 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// This file is part of the romato library.
+//
+// Copyright 2013-2026 Rocco Matano
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <intrin.h>
+#include <type_traits>
+#include "container.h"
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Binary trace buffers with deferred formatting.
+//
+// TraceWrite() does not format anything. It stores the address of the format
+// string, a time stamp (rdtsc) and the raw arguments in a ring that belongs
+// to the calling thread (spsc_ring, found via TLS, so there is no lock and no
+// shared cache line in the hot path). String arguments are copied, but
+// truncated to fit into TRACE_STR_SPACE bytes per event. If a ring is full,
+// the event is dropped and counted.
+//
+// Formatting happens later: TraceDrain() (or the drain thread started by
+// TraceStartDrainThread) merges the events of all rings by time stamp,
+// formats them and hands the text to a sink. TraceDumpAll() is the same for
+// use in a crash handler.
+//
+// The arguments are stored as an image of a va_list, so the original printf
+// format strings can be used. Hence the format string has to be a literal
+// (or at least live as long as the process) and arguments must be numbers,
+// pointers or strings.
+//
+// With ROMATO_ACTIVATE_TRACES and ROMATO_TRACE_RING set, the TRACE macro
+// uses TraceWrite instead of DbgPrintf.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+const UINT TRACE_MAX_ARGS = 8;
+const UINT TRACE_STR_SPACE = 64;
+
+// Size of an argument in a va_list: 8 bytes each on x64, on x86 the size
+// rounded up to 4 bytes.
+template <class T> constexpr UINT TraceSlotSize()
+{
+    return sizeof(void*) == 8 ? 8 : (sizeof(T) + 3) & ~3;
+}
+
+// default argument promotions
+template <class T> struct TracePromote
+{
+    using type = typename std::conditional<
+        std::is_floating_point<T>::value,
+        double,
+        typename std::conditional<
+            (std::is_integral<T>::value || std::is_enum<T>::value) &&
+            sizeof(T) < sizeof(int),
+            int,
+            T
+            >::type
+        >::type;
+};
+
+struct TraceEvent
+{
+    const char* fmt;
+    UINT64 tsc;
+    BYTE args[TRACE_MAX_ARGS * 8];
+    BYTE num_str;
+    BYTE str_slot[TRACE_MAX_ARGS];      // offset of string args in 'args'
+    char strs[TRACE_STR_SPACE];
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Fills the arguments of a TraceEvent.
+class TraceArgWriter
+{
+public:
+
+    explicit TraceArgWriter(TraceEvent& evt) :
+        m_evt(evt),
+        m_args(0),
+        m_strs(0)
+    {
+        evt.num_str = 0;
+    }
+
+    template <class T> void put(T val)
+    {
+        static_assert(
+            std::is_arithmetic<T>::value ||
+            std::is_enum<T>::value ||
+            std::is_pointer<T>::value,
+            "unsupported TRACE argument"
+            );
+        store(static_cast<typename TracePromote<T>::type>(val));
+    }
+
+    void put(const char* str)
+    {
+        put_str(str ? str : "(null)", sizeof(char), false);
+    }
+
+    void put(char* str)
+    {
+        put(static_cast<const char*>(str));
+    }
+
+    void put(const WCHAR* str)
+    {
+        put_str(str ? str : L"(null)", sizeof(WCHAR), true);
+    }
+
+    void put(WCHAR* str)
+    {
+        put(static_cast<const WCHAR*>(str));
+    }
+
+protected:
+
+    template <class T> void store(T val)
+    {
+        memcpy(m_evt.args + m_args, &val, sizeof(T));
+        m_args += TraceSlotSize<T>();
+    }
+
+    // The slot receives the offset of the copy in 'strs', which is replaced
+    // by a pointer when the event gets formatted. TRACE_STR_SPACE stands for
+    // an empty string, if there is no space left.
+    void put_str(const void* str, UINT char_size, bool wide)
+    {
+        // wide strings start at an even offset
+        m_strs = (m_strs + char_size - 1) & ~(char_size - 1);
+        const UINT avail = (
+            m_strs < TRACE_STR_SPACE ?
+            (TRACE_STR_SPACE - m_strs) / char_size :
+            0
+            );
+        m_evt.str_slot[m_evt.num_str++] = static_cast<BYTE>(m_args);
+        store(static_cast<uintptr_t>(avail ? m_strs : TRACE_STR_SPACE));
+        if (!avail)
+        {
+            return;
+        }
+
+        UINT len = 0;
+        if (wide)
+        {
+            auto src = static_cast<const WCHAR*>(str);
+            while (len + 1 < avail && src[len])
+            {
+                ++len;
+            }
+        }
+        else
+        {
+            auto src = static_cast<const char*>(str);
+            while (len + 1 < avail && src[len])
+            {
+                ++len;
+            }
+        }
+        BYTE* dst = p2p<BYTE*>(m_evt.strs) + m_strs;
+        memcpy(dst, str, len * char_size);
+        memset(dst + len * char_size, 0, char_size);
+        m_strs += (len + 1) * char_size;
+    }
+
+    TraceEvent& m_evt;
+    UINT m_args;
+    UINT m_strs;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+struct TraceThread
+{
+    explicit TraceThread(size_t capacity) :
+        ring(capacity),
+        thread_id(GetCurrentThreadId()),
+        dropped(0),
+        next(nullptr),
+        has_pending(false)
+    {
+    }
+
+    spsc_ring<TraceEvent> ring;
+    DWORD thread_id;
+    std::atomic<UINT64> dropped;
+    TraceThread* next;
+
+    // consumer side, the oldest event that was taken out of the ring but is
+    // not formatted yet
+    TraceEvent pending;
+    bool has_pending;
+};
+
+extern std::atomic<DWORD> g_trace_tls;
+TraceThread* TraceCreateThread();
+
+inline TraceThread* TraceCurrentThread()
+{
+    // TlsGetValue clears the last error on success, so restore it for the
+    // code that is being traced.
+    const DWORD err = GetLastError();
+    auto self = static_cast<TraceThread*>(
+        TlsGetValue(g_trace_tls.load(std::memory_order_relaxed))
+        );
+    SetLastError(err);
+    return self ? self : TraceCreateThread();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <class... ARGS> void TraceWrite(const char* fmt, ARGS... args)
+{
+    static_assert(
+        sizeof...(ARGS) <= TRACE_MAX_ARGS,
+        "too many TRACE arguments"
+        );
+    // Resolve the thread first, the very first call initializes the time
+    // base that the stamp is relative to.
+    TraceThread* self = TraceCurrentThread();
+
+    TraceEvent evt;
+    evt.fmt = fmt;
+    evt.tsc = __rdtsc();
+    TraceArgWriter writer(evt);
+    (writer.put(args), ...);
+
+    if (!self->ring.try_push(std::move(evt)))
+    {
+        self->dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Number of events per thread, has to be a power of two. Only affects threads
+// that did not trace yet.
+void TraceSetRingCapacity(size_t capacity);
+
+// Formats all events that have been recorded so far. 'sink' may be nullptr,
+// which means OutputDebugString.
+void TraceDrain(DBG_SINK_FUNC sink, void* ctx);
+
+// Like TraceDrain, but gives up if another drain does not finish within a
+// short time. Meant for crash handlers.
+bool TraceDumpAll(DBG_SINK_FUNC sink, void* ctx);
+
+// A background thread calls TraceDrain every 'interval_ms'.
+bool TraceStartDrainThread(UINT interval_ms, DBG_SINK_FUNC sink, void* ctx);
+
+// Stops the drain thread after a final drain.
+void TraceStopDrainThread();
+
+////////////////////////////////////////////////////////////////////////////////
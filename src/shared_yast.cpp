@@ -0,0 +1,64 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// This file is part of the romato library.
+//
+// Copyright 2013-2026 Rocco Matano
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "romato.h"
+#include "shared_yast.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+SharedYast::YSTR SharedYast::allocate_bytes(const void* str, UINT length)
+{
+    // Add space for header and terminating 0, then align (see Yast).
+    const UINT alignment = 16;
+    const UINT mask = alignment - 1;
+    const UINT add_len = HEADER_SIZE + sizeof(WCHAR) + mask;
+    if (length > Yast::MAX_BYTE_LEN)
+    {
+        length = Yast::MAX_BYTE_LEN;
+    }
+    const UINT alloc_len = (length + add_len) & ~mask;
+
+    // Allocate memory, init reference count and store length.
+    auto p = static_cast<PSTR>(malloc(alloc_len));
+    *p2p<LONG*>(p) = 1;
+    auto p_length = p2p<uint32_t*>(p + HEADER_SIZE - sizeof(uint32_t));
+    *p_length = length;
+
+    // Copy init data.
+    auto res = p + HEADER_SIZE;
+    if (str)
+    {
+        memcpy(res, str, length);
+    }
+
+    // Write CHAR and WCHAR terminator (see Yast::allocate_bytes).
+    *(res + length) = 0;
+    *(p2p<PWSTR>(res + (~1 & (length + 1)))) = 0;
+
+    return p2p<YSTR>(res);
+}
+
+////////////////////////////////////////////////////////////////////////////////
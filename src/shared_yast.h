@@ -0,0 +1,317 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// This file is part of the romato library.
+//
+// Copyright 2013-2026 Rocco Matano
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// SharedYast is a copy-on-write sibling of Yast. Copying a SharedYast only
+// increments an (atomic) reference count, so strings can be handed around
+// between containers, list item data and callbacks without touching the heap.
+// Any access that might modify the characters (operator PWSTR, non-const
+// begin/end, ...) first detaches, i.e. makes a private copy if the buffer is
+// shared.
+//
+// The memory layout mirrors the one of Yast: m_str points to the characters,
+// which are preceded by the length. The reference count lives in front of
+// the length:
+//
+//     | refs | (pad) | length | characters ... | 0 |
+//                              ^
+//                              m_str
+//
+// As with any COW string, the usual caveat applies: a pointer obtained from
+// operator PWSTR is only valid until the object is copied or modified.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "yast.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+class SharedYast
+{
+protected:
+
+    using YSTR = WCHAR*;
+
+    static const UINT HEADER_SIZE = 2 * sizeof(uintptr_t);
+
+    static YSTR allocate_bytes(const void* str, UINT length);
+
+    static YSTR allocate(PCWSTR str, UINT length)
+    {
+        return allocate_bytes(str, length * sizeof(WCHAR));
+    }
+
+    static volatile LONG* p_refs(YSTR str)
+    {
+        return p2p<volatile LONG*>(p2p<BYTE*>(str) - HEADER_SIZE);
+    }
+
+    static void add_ref(YSTR str)
+    {
+        InterlockedIncrement(p_refs(str));
+    }
+
+    static void release(YSTR str)
+    {
+        if (str && InterlockedDecrement(p_refs(str)) == 0)
+        {
+            free(p2p<BYTE*>(str) - HEADER_SIZE);
+        }
+    }
+
+    // make sure we are the only owner of the buffer
+    void detach()
+    {
+        if (*p_refs(m_str) != 1)
+        {
+            YSTR const tmp = allocate_bytes(m_str, byte_length());
+            release(m_str);
+            m_str = tmp;
+        }
+    }
+
+    YSTR m_str;
+
+public:
+
+    UINT byte_length() const
+    {
+        auto p_length = reinterpret_cast<uint32_t*>(m_str) - 1;
+        return *p_length;
+    }
+
+    UINT length() const
+    {
+        return byte_length() / sizeof(WCHAR);
+    }
+
+    // Mainly meant for diagnostic purposes. The value might already be
+    // outdated when it is returned.
+    LONG use_count() const
+    {
+        return *p_refs(m_str);
+    }
+
+    ~SharedYast()
+    {
+        release(m_str);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    ///////////////////////////// constructors /////////////////////////////////
+    ////////////////////////////////////////////////////////////////////////////
+
+    SharedYast()
+        : m_str(allocate(nullptr, 0))
+    {
+    }
+
+    SharedYast(const SharedYast& src)
+        : m_str(src.m_str)
+    {
+        add_ref(m_str);
+    }
+
+    SharedYast(SharedYast&& src)
+        : m_str(src.m_str)
+    {
+        // Like Yast, this is the only place where m_str becomes nullptr.
+        src.m_str = nullptr;
+    }
+
+    SharedYast(PCWSTR p_src)
+        : m_str(allocate(p_src, p_src ? sz_lenW(p_src) : 0))
+    {
+    }
+
+    SharedYast(PCWSTR p_str, UINT size)
+        : m_str(allocate(p_str, size))
+    {
+    }
+
+    explicit SharedYast(const Yast& src)
+        : m_str(allocate_bytes(src.str(), src.byte_length()))
+    {
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    /////////////////////////////// casting ////////////////////////////////////
+    ////////////////////////////////////////////////////////////////////////////
+
+    operator PCWSTR() const
+    {
+        return m_str;
+    }
+
+    PCWSTR str() const
+    {
+        return m_str;
+    }
+
+    operator PWSTR()
+    {
+        detach();
+        return m_str;
+    }
+
+    Yast to_yast() const
+    {
+        return Yast(m_str, length());
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    //////////////////////// assignment operators //////////////////////////////
+    ////////////////////////////////////////////////////////////////////////////
+
+    SharedYast& operator=(const SharedYast& src)
+    {
+        if (m_str != src.m_str)
+        {
+            add_ref(src.m_str);
+            release(m_str);
+            m_str = src.m_str;
+        }
+        return *this;
+    }
+
+    SharedYast& operator=(SharedYast&& src)
+    {
+        YSTR const str = m_str;
+        m_str = src.m_str;
+        src.m_str = str;
+        return *this;
+    }
+
+    SharedYast& operator=(PCWSTR p_src)
+    {
+        YSTR const tmp = allocate(p_src, p_src ? sz_lenW(p_src) : 0);
+        release(m_str);
+        m_str = tmp;
+        return *this;
+    }
+
+    SharedYast& operator=(const Yast& src)
+    {
+        YSTR const tmp = allocate_bytes(src.str(), src.byte_length());
+        release(m_str);
+        m_str = tmp;
+        return *this;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    ////////////////////////////// iterators ///////////////////////////////////
+    ////////////////////////////////////////////////////////////////////////////
+
+    using iterator               = array_iterator<WCHAR>;
+    using const_iterator         = array_const_iterator<WCHAR>;
+
+    iterator begin()
+    {
+        detach();
+        return iterator(m_str);
+    }
+
+    const_iterator begin() const
+    {
+        return const_iterator(m_str);
+    }
+
+    iterator end()
+    {
+        detach();
+        return iterator(m_str + length());
+    }
+
+    const_iterator end() const
+    {
+        return const_iterator(m_str + length());
+    }
+
+    const_iterator cbegin() const
+    {
+        return begin();
+    }
+
+    const_iterator cend() const
+    {
+        return end();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    ////////////////////////////// comparison //////////////////////////////////
+    ////////////////////////////////////////////////////////////////////////////
+
+    size_t hash() const
+    {
+        return Yast::hash_bytes(m_str, byte_length());
+    }
+
+    bool operator==(const SharedYast& cmp) const
+    {
+        if (m_str == cmp.m_str)
+        {
+            return true;
+        }
+        return (
+            length() == cmp.length() &&
+            CompareStringW(
+                LOCALE_USER_DEFAULT,
+                SORT_STRINGSORT,
+                m_str,
+                length(),
+                cmp.m_str,
+                cmp.length()
+                ) == CSTR_EQUAL
+            );
+    }
+
+    bool operator!=(const SharedYast& cmp) const
+    {
+        return !operator==(cmp);
+    }
+};
+
+static_assert(
+    sizeof(SharedYast) == sizeof(void*),
+    "Unexpected size of SharedYast"
+    );
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace std
+{
+    template<> struct hash<SharedYast>
+    {
+        size_t operator()(SharedYast const& s) const noexcept
+        {
+            return s.hash();
+        }
+    };
+}
+
+////////////////////////////////////////////////////////////////////////////////
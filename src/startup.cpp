@@ -46,14 +46,14 @@
 #define _STATIC_CTORS_ 0
 #endif
 
+using P_V_FUNC_V = void(__cdecl*)(void);
+
 #if _STATIC_CTORS_
 
 //////////////////////////////////////////////////////////////////////////////
 //////////////////////////// Initializers ////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////
 
-using P_V_FUNC_V = void(__cdecl*)(void);
-
 #ifdef _MSC_VER
 
 #pragma section(".CRT$XCA", read)
@@ -82,6 +82,8 @@ static void FORCEINLINE CallInitializers()
 
 #endif
 
+#endif // _STATIC_CTORS_
+
 //////////////////////////////////////////////////////////////////////////////
 ////////////////////////////  Terminators  ///////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////
@@ -94,7 +96,9 @@ struct EXIT_ENTRY
     P_V_FUNC_V ExitFunc;
 };
 
-static EXIT_ENTRY ExitList; // list head
+// List head, constant initialized, so that atexit can be used regardless of
+// ROMATO_CONSTRUCT_STATIC_OBJECTS (e.g. to flush buffered output).
+static EXIT_ENTRY ExitList = {&ExitList, nullptr};
 
 //////////////////////////////////////////////////////////////////////////////
 
@@ -131,8 +135,6 @@ static void FORCEINLINE CallTerminators()
     }
 }
 
-#endif // _STATIC_CTORS_
-
 //////////////////////////////////////////////////////////////////////////////
 ////////////////////////////  Entry Point  ///////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////
@@ -140,17 +142,12 @@ static void FORCEINLINE CallTerminators()
 extern "C" void EntryPoint()
 {
 #if _STATIC_CTORS_
-    // Initializers will likely call 'atexit'. Therefore prepare
-    // 'ExitList' before calling initializers.
-    ExitList.Next = &ExitList;
     CallInitializers();
 #endif
 
     const int result = rm_main();
 
-#if _STATIC_CTORS_
     CallTerminators();
-#endif
 
     ExitProcess(result);
 }
@@ -0,0 +1,120 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// This file is part of the romato library.
+//
+// Copyright 2013-2026 Rocco Matano
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "romato.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Intentionally no objects with constructors, because static constructors
+// are only executed if ROMATO_CONSTRUCT_STATIC_OBJECTS is set.
+static SRWLOCK s_tables_lock = SRWLOCK_INIT;
+static StringTable* s_tables;
+
+// shared by all blocks that do not exist
+static StringResView s_missing_block[STRING_RES_BLOCK_SIZE];
+
+////////////////////////////////////////////////////////////////////////////////
+
+StringTable::StringTable(HINSTANCE h_inst, UINT lang_id) :
+    m_inst(h_inst),
+    m_lang(lang_id),
+    m_next(nullptr)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+StringTable& StringTable::get(HINSTANCE h_inst, UINT lang_id)
+{
+    AcquireSRWLockShared(&s_tables_lock);
+    StringTable* table = s_tables;
+    while (table && (table->m_inst != h_inst || table->m_lang != lang_id))
+    {
+        table = table->m_next;
+    }
+    ReleaseSRWLockShared(&s_tables_lock);
+    if (table)
+    {
+        return *table;
+    }
+
+    AcquireSRWLockExclusive(&s_tables_lock);
+    table = s_tables;
+    while (table && (table->m_inst != h_inst || table->m_lang != lang_id))
+    {
+        table = table->m_next;
+    }
+    if (!table)
+    {
+        table = new StringTable(h_inst, lang_id);
+        table->m_next = s_tables;
+        s_tables = table;
+    }
+    ReleaseSRWLockExclusive(&s_tables_lock);
+    return *table;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+StringResView* StringTable::load_block(UINT blk_idx)
+{
+    // This code deliberately ignores 16 bit semantics for resources.
+    // I.e. there is no call to LockResource, UnlockResource or FreeResource.
+    StringResView* blk = s_missing_block;
+    HRSRC h_res = FindResourceEx(
+        m_inst,
+        RT_STRING,
+        MAKEINTRESOURCE(blk_idx + 1),
+        static_cast<WORD>(m_lang)
+        );
+    const void* data = h_res ? LoadResource(m_inst, h_res) : nullptr;
+    if (data)
+    {
+        blk = static_cast<StringResView*>(
+            malloc(sizeof(StringResView) * STRING_RES_BLOCK_SIZE)
+            );
+        ParseStringBlock(data, SizeofResource(m_inst, h_res), blk);
+    }
+
+    // If another thread was faster, use its result.
+    StringResView* expected = nullptr;
+    if (!m_blocks[blk_idx].compare_exchange_strong(
+        expected,
+        blk,
+        std::memory_order_acq_rel,
+        std::memory_order_acquire
+        ))
+    {
+        if (blk != s_missing_block)
+        {
+            free(blk);
+        }
+        blk = expected;
+    }
+    return blk;
+}
+
+////////////////////////////////////////////////////////////////////////////////
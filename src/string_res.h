@@ -26,6 +26,8 @@
 
 #pragma once
 
+#include <atomic>
+
 struct StringResourceEntry
 {
     WORD m_length;
@@ -61,3 +63,113 @@ inline StringResourceEntry* FindStringResource(
     }
     return reinterpret_cast<StringResourceEntry*>(p_tmp);
 }
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Indexed access to string resources.
+//
+// A string table resource consists of blocks of 16 strings. Block n holds
+// the ids 16 * (n - 1) to 16 * n - 1 and every string is stored as a WORD
+// length followed by that many WCHARs (not zero terminated).
+// FindStringResource has to locate the block and walk its entries on every
+// call. A StringTable does that only once per block: the first lookup of an
+// id parses its block into 16 views that point directly into the resource
+// section and later lookups are a mere array access.
+//
+// StringTable::get() returns the table for a (module, language) pair. It is
+// created on first use and lives until the process ends, so it must not be
+// used for modules that get unloaded. Hence the index is opt-in:
+// Yast::load_res_string only uses it if it is given a StringTable.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+struct StringResView
+{
+    PCWSTR str; // nullptr if the string does not exist
+    UINT len;
+};
+
+const UINT STRING_RES_BLOCK_SIZE = 16;
+const UINT STRING_RES_NUM_BLOCKS = 0x10000 / STRING_RES_BLOCK_SIZE;
+
+// Splits the raw data of a string table block into its entries. Never reads
+// beyond 'size' bytes, entries that are cut off by the end of the data are
+// reported as missing. Returns the number of complete entries.
+inline UINT ParseStringBlock(
+    const void* data,
+    size_t size,
+    StringResView views[STRING_RES_BLOCK_SIZE]
+    )
+{
+    auto pos = static_cast<const WORD*>(data);
+    size_t avail = size / sizeof(WORD);
+    UINT num = 0;
+    for (; num < STRING_RES_BLOCK_SIZE; num++)
+    {
+        if (!avail || *pos >= avail)
+        {
+            break;
+        }
+        views[num].str = reinterpret_cast<PCWSTR>(pos + 1);
+        views[num].len = *pos;
+        avail -= 1 + *pos;
+        pos += 1 + *pos;
+    }
+    for (UINT i = num; i < STRING_RES_BLOCK_SIZE; i++)
+    {
+        views[i].str = nullptr;
+        views[i].len = 0;
+    }
+    return num;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+class StringTable
+{
+public:
+
+    static StringTable& get(
+        HINSTANCE h_inst,
+        UINT lang_id = MAKELANGID(LANG_NEUTRAL, SUBLANG_NEUTRAL)
+        );
+
+    // Zero copy lookup, the view points into the resource section. An empty
+    // string (length 0) counts as existing, just like for
+    // FindStringResource.
+    bool lookup(UINT str_id, StringResView& view)
+    {
+        if (str_id > 0xffff)
+        {
+            view.str = nullptr;
+            view.len = 0;
+            return false;
+        }
+        const UINT blk_idx = str_id / STRING_RES_BLOCK_SIZE;
+        StringResView* blk = m_blocks[blk_idx].load(
+            std::memory_order_acquire
+            );
+        if (!blk)
+        {
+            blk = load_block(blk_idx);
+        }
+        view = blk[str_id % STRING_RES_BLOCK_SIZE];
+        return view.str != nullptr;
+    }
+
+    StringTable(const StringTable&) = delete;
+    StringTable& operator=(const StringTable&) = delete;
+
+protected:
+
+    StringTable(HINSTANCE h_inst, UINT lang_id);
+
+    StringResView* load_block(UINT blk_idx);
+
+    HINSTANCE m_inst;
+    UINT m_lang;
+    StringTable* m_next;
+    std::atomic<StringResView*> m_blocks[STRING_RES_NUM_BLOCKS];
+};
+
+////////////////////////////////////////////////////////////////////////////////
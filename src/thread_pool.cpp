@@ -0,0 +1,428 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// This file is part of the romato library.
+//
+// Copyright 2013-2026 Rocco Matano
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "romato.h"
+#include "thread_pool.h"
+
+////////////////////////////////////////////////////////////////////////////////
+//////////////////////////// WorkStealDeque ////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+WorkStealDeque::WorkStealDeque() :
+    m_top(0),
+    m_bottom(0),
+    m_array(alloc_array(256, nullptr))
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+WorkStealDeque::~WorkStealDeque()
+{
+    Array* a = m_array.load();
+    while (a)
+    {
+        Array* const retired = a->retired;
+        free(a);
+        a = retired;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+WorkStealDeque::Array* WorkStealDeque::alloc_array(
+    intptr_t size,
+    Array* retired
+    )
+{
+    // malloc returns zeroed memory
+    auto a = static_cast<Array*>(
+        malloc(sizeof(Array) + (size - 1) * sizeof(std::atomic<PoolTask*>))
+        );
+    a->mask = size - 1;
+    a->retired = retired;
+    return a;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+WorkStealDeque::Array* WorkStealDeque::grow(
+    Array* old,
+    intptr_t bottom,
+    intptr_t top
+    )
+{
+    // Thieves might still be reading from the old array, so it is kept
+    // until the deque is destroyed.
+    Array* const a = alloc_array((old->mask + 1) * 2, old);
+    for (intptr_t i = top; i < bottom; i++)
+    {
+        a->put(i, old->get(i));
+    }
+    m_array.store(a, std::memory_order_release);
+    return a;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void WorkStealDeque::push(PoolTask* task)
+{
+    const intptr_t b = m_bottom.load(std::memory_order_relaxed);
+    const intptr_t t = m_top.load(std::memory_order_acquire);
+    Array* a = m_array.load(std::memory_order_relaxed);
+    if (b - t > a->mask)
+    {
+        a = grow(a, b, t);
+    }
+    a->put(b, task);
+    std::atomic_thread_fence(std::memory_order_release);
+    m_bottom.store(b + 1, std::memory_order_relaxed);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+PoolTask* WorkStealDeque::pop()
+{
+    const intptr_t b = m_bottom.load(std::memory_order_relaxed) - 1;
+    Array* const a = m_array.load(std::memory_order_relaxed);
+    m_bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    intptr_t t = m_top.load(std::memory_order_relaxed);
+
+    if (t > b)
+    {
+        // empty
+        m_bottom.store(b + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    PoolTask* task = a->get(b);
+    if (t == b)
+    {
+        // last item: race against thieves
+        if (
+            !m_top.compare_exchange_strong(
+                t,
+                t + 1,
+                std::memory_order_seq_cst,
+                std::memory_order_relaxed
+                )
+            )
+        {
+            task = nullptr;
+        }
+        m_bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return task;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+PoolTask* WorkStealDeque::steal()
+{
+    intptr_t t = m_top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const intptr_t b = m_bottom.load(std::memory_order_acquire);
+    if (t >= b)
+    {
+        return nullptr;
+    }
+    Array* const a = m_array.load(std::memory_order_acquire);
+    PoolTask* const task = a->get(t);
+    if (
+        !m_top.compare_exchange_strong(
+            t,
+            t + 1,
+            std::memory_order_seq_cst,
+            std::memory_order_relaxed
+            )
+        )
+    {
+        return nullptr;
+    }
+    return task;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////// ThreadPool //////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+ThreadPool::ThreadPool(UINT num_threads) :
+    m_workers(nullptr),
+    m_num_workers(num_threads),
+    m_tls_idx(TlsAlloc()),
+    m_queued(0),
+    m_sleepers(0),
+    m_shutdown(false)
+{
+    if (m_tls_idx == TLS_OUT_OF_INDEXES)
+    {
+        RaiseException(HRESULT_FROM_WIN32(GetLastError()));
+    }
+    InitializeSRWLock(&m_inject_lock);
+    InitializeSRWLock(&m_sleep_lock);
+    InitializeConditionVariable(&m_wake_cv);
+
+    if (m_num_workers == 0)
+    {
+        SYSTEM_INFO si;
+        GetSystemInfo(&si);
+        m_num_workers = si.dwNumberOfProcessors ? si.dwNumberOfProcessors : 1;
+    }
+
+    // Worker contains a non-copyable deque, so construct them in place.
+    m_workers = static_cast<Worker*>(malloc(m_num_workers * sizeof(Worker)));
+    for (UINT i = 0; i < m_num_workers; i++)
+    {
+        Worker* const w = new (&m_workers[i]) Worker();
+        w->pool = this;
+        w->index = i;
+        w->rng = 2654435761U * (i + 1);
+    }
+    for (UINT i = 0; i < m_num_workers; i++)
+    {
+        Worker* const w = &m_workers[i];
+        w->thread = CreateThread(nullptr, 0, worker_proc, w, 0, nullptr);
+        if (w->thread == nullptr)
+        {
+            RaiseException(HRESULT_FROM_WIN32(GetLastError()));
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+ThreadPool::~ThreadPool()
+{
+    AcquireSRWLockExclusive(&m_sleep_lock);
+    m_shutdown = true;
+    WakeAllConditionVariable(&m_wake_cv);
+    ReleaseSRWLockExclusive(&m_sleep_lock);
+
+    // Join all workers before destroying any of them, because a worker that
+    // is still running might try to steal from another worker's deque.
+    for (UINT i = 0; i < m_num_workers; i++)
+    {
+        WaitForSingleObject(m_workers[i].thread, INFINITE);
+        CloseHandle(m_workers[i].thread);
+    }
+    for (UINT i = 0; i < m_num_workers; i++)
+    {
+        m_workers[i].~Worker();
+    }
+    free(m_workers);
+    TlsFree(m_tls_idx);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ThreadPool::submit(POOL_TASK_FUNC func, void* ctx, TaskGroup* group)
+{
+    auto task = new PoolTask;
+    task->func = func;
+    task->ctx = ctx;
+    task->group = group;
+    if (group)
+    {
+        group->m_pending.fetch_add(1);
+    }
+
+    Worker* const self = current_worker();
+    if (self)
+    {
+        self->deque.push(task);
+    }
+    else
+    {
+        AcquireSRWLockExclusive(&m_inject_lock);
+        m_inject.push_back(task);
+        ReleaseSRWLockExclusive(&m_inject_lock);
+    }
+
+    m_queued.fetch_add(1);
+    if (m_sleepers.load() > 0)
+    {
+        wake_sleepers(false);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ThreadPool::wake_sleepers(bool all)
+{
+    // Taking the lock guarantees, that a thread that has decided to sleep is
+    // really waiting on the condition variable before we signal it.
+    AcquireSRWLockExclusive(&m_sleep_lock);
+    if (all)
+    {
+        WakeAllConditionVariable(&m_wake_cv);
+    }
+    else
+    {
+        WakeConditionVariable(&m_wake_cv);
+    }
+    ReleaseSRWLockExclusive(&m_sleep_lock);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+PoolTask* ThreadPool::find_task(Worker* self)
+{
+    PoolTask* task = nullptr;
+    if (self)
+    {
+        task = self->deque.pop();
+    }
+
+    if (task == nullptr && m_queued.load(std::memory_order_relaxed) > 0)
+    {
+        AcquireSRWLockExclusive(&m_inject_lock);
+        if (!m_inject.empty())
+        {
+            task = m_inject.front();
+            m_inject.pop_front();
+        }
+        ReleaseSRWLockExclusive(&m_inject_lock);
+
+        // Try every other worker once, starting at a random victim.
+        uint32_t rng = self ? self->rng : GetTickCount();
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        if (self)
+        {
+            self->rng = rng;
+        }
+        const UINT start = rng % m_num_workers;
+        for (UINT i = 0; task == nullptr && i < m_num_workers; i++)
+        {
+            Worker* const victim = &m_workers[(start + i) % m_num_workers];
+            if (victim != self)
+            {
+                task = victim->deque.steal();
+            }
+        }
+    }
+
+    if (task)
+    {
+        m_queued.fetch_sub(1);
+    }
+    return task;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ThreadPool::execute(PoolTask* task)
+{
+    task->func(task->ctx);
+    TaskGroup* const group = task->group;
+    delete task;
+    if (group && group->m_pending.fetch_sub(1) == 1 && m_sleepers.load() > 0)
+    {
+        // Somebody might be waiting for this group.
+        wake_sleepers(true);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool ThreadPool::run_one()
+{
+    PoolTask* const task = find_task(current_worker());
+    if (task)
+    {
+        execute(task);
+    }
+    return task != nullptr;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <class DONE> void ThreadPool::sleep_until(DONE done)
+{
+    AcquireSRWLockExclusive(&m_sleep_lock);
+    m_sleepers.fetch_add(1);
+    // Checking m_queued after announcing ourselves as a sleeper closes the
+    // window for a lost wake up (see submit).
+    while (!done() && m_queued.load() <= 0 && !m_shutdown)
+    {
+        SleepConditionVariableSRW(&m_wake_cv, &m_sleep_lock, INFINITE, 0);
+    }
+    m_sleepers.fetch_sub(1);
+    ReleaseSRWLockExclusive(&m_sleep_lock);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+DWORD WINAPI ThreadPool::worker_proc(void* param)
+{
+    auto self = static_cast<Worker*>(param);
+    ThreadPool* const pool = self->pool;
+    TlsSetValue(pool->m_tls_idx, self);
+
+    const int spin_rounds = 64;
+    for (;;)
+    {
+        PoolTask* task = nullptr;
+        for (int spin = 0; task == nullptr && spin < spin_rounds; spin++)
+        {
+            task = pool->find_task(self);
+            if (task == nullptr)
+            {
+                YieldProcessor();
+            }
+        }
+        if (task)
+        {
+            pool->execute(task);
+            continue;
+        }
+        if (pool->m_shutdown && pool->m_queued.load() <= 0)
+        {
+            break;
+        }
+        pool->sleep_until([] { return false; });
+    }
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////// TaskGroup ///////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+void TaskGroup::wait()
+{
+    while (!is_done())
+    {
+        if (!m_pool.run_one())
+        {
+            m_pool.sleep_until([this] { return is_done(); });
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,238 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// This file is part of the romato library.
+//
+// Copyright 2013-2026 Rocco Matano
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// A work-stealing thread pool.
+//
+// Every worker owns a Chase-Lev deque. Tasks that are submitted from a worker
+// are pushed onto that worker's deque (LIFO for the owner, which keeps caches
+// warm for recursive work like scanning directory trees), while tasks that
+// are submitted from any other thread go to a global injection queue. Idle
+// workers first look at their own deque, then at the injection queue and
+// finally try to steal from the other workers (FIFO end). If there is still
+// nothing to do, they spin briefly and then go to sleep on a condition
+// variable until new work arrives.
+//
+// A TaskGroup tracks a set of tasks and lets a thread wait for all of them.
+// Waiting threads help executing pending tasks instead of just blocking.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "container.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+using POOL_TASK_FUNC = void(*)(void* ctx);
+
+class ThreadPool;
+class TaskGroup;
+
+struct PoolTask
+{
+    POOL_TASK_FUNC func;
+    void* ctx;
+    TaskGroup* group;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Chase-Lev deque as described in "Correct and Efficient Work-Stealing for
+// Weak Memory Models" (Le, Pop, Cohen, Zappa Nardelli). push and pop must only
+// be called by the owning worker, steal by anybody.
+
+class WorkStealDeque
+{
+public:
+    WorkStealDeque();
+    ~WorkStealDeque();
+
+    WorkStealDeque(const WorkStealDeque&) = delete;
+    WorkStealDeque& operator=(const WorkStealDeque&) = delete;
+
+    void push(PoolTask* task);
+    PoolTask* pop();
+
+    // Might return nullptr even though the deque is not empty (if another
+    // thief or the owner won the race for the last item).
+    PoolTask* steal();
+
+    bool is_empty() const
+    {
+        return (
+            m_bottom.load(std::memory_order_relaxed) <=
+            m_top.load(std::memory_order_relaxed)
+            );
+    }
+
+protected:
+
+    struct Array
+    {
+        intptr_t mask;
+        Array* retired;
+        std::atomic<PoolTask*> items[ANYSIZE_ARRAY];
+
+        PoolTask* get(intptr_t idx)
+        {
+            return items[idx & mask].load(std::memory_order_relaxed);
+        }
+
+        void put(intptr_t idx, PoolTask* task)
+        {
+            items[idx & mask].store(task, std::memory_order_relaxed);
+        }
+    };
+
+    static Array* alloc_array(intptr_t size, Array* retired);
+    Array* grow(Array* old, intptr_t bottom, intptr_t top);
+
+    std::atomic<intptr_t> m_top;
+    char m_pad0[ROMATO_CACHE_LINE - sizeof(intptr_t)];
+    std::atomic<intptr_t> m_bottom;
+    std::atomic<Array*> m_array;
+    char m_pad1[ROMATO_CACHE_LINE - sizeof(intptr_t) - sizeof(Array*)];
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+class ThreadPool
+{
+public:
+
+    // 'num_threads' == 0 means one worker per logical processor.
+    explicit ThreadPool(UINT num_threads = 0);
+
+    // Waits until all tasks (including those that are submitted by tasks that
+    // are still running) have been executed.
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(POOL_TASK_FUNC func, void* ctx, TaskGroup* group = nullptr);
+
+    // Execute one pending task on the calling thread, if there is any.
+    bool run_one();
+
+    UINT num_threads() const
+    {
+        return m_num_workers;
+    }
+
+    // true, if the calling thread is one of this pool's workers
+    bool is_worker_thread() const
+    {
+        return current_worker() != nullptr;
+    }
+
+protected:
+
+    friend class TaskGroup;
+
+    struct Worker
+    {
+        WorkStealDeque deque;
+        ThreadPool* pool;
+        HANDLE thread;
+        UINT index;
+        uint32_t rng;
+    };
+
+    static DWORD WINAPI worker_proc(void* param);
+
+    Worker* current_worker() const
+    {
+        return static_cast<Worker*>(TlsGetValue(m_tls_idx));
+    }
+
+    PoolTask* find_task(Worker* self);
+    void execute(PoolTask* task);
+    void wake_sleepers(bool all);
+
+    // Block the calling thread until there is work to do or 'done' returns
+    // true (or the pool shuts down).
+    template <class DONE> void sleep_until(DONE done);
+
+    Worker* m_workers;
+    UINT m_num_workers;
+    DWORD m_tls_idx;
+
+    SRWLOCK m_inject_lock;
+    cdeque<PoolTask*> m_inject;
+
+    // Number of tasks that have been submitted but not yet taken. May become
+    // negative for a moment, because it is incremented after the task became
+    // visible.
+    std::atomic<LONG> m_queued;
+    std::atomic<LONG> m_sleepers;
+    SRWLOCK m_sleep_lock;
+    CONDITION_VARIABLE m_wake_cv;
+    std::atomic<bool> m_shutdown;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+class TaskGroup
+{
+public:
+
+    explicit TaskGroup(ThreadPool& pool) : m_pool(pool), m_pending(0)
+    {
+    }
+
+    ~TaskGroup()
+    {
+        wait();
+    }
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    void run(POOL_TASK_FUNC func, void* ctx)
+    {
+        m_pool.submit(func, ctx, this);
+    }
+
+    // Wait until all tasks of this group have been executed. The calling
+    // thread helps executing pending tasks of the pool in the meantime.
+    void wait();
+
+    bool is_done() const
+    {
+        return m_pending.load(std::memory_order_acquire) == 0;
+    }
+
+protected:
+
+    friend class ThreadPool;
+
+    ThreadPool& m_pool;
+    std::atomic<LONG> m_pending;
+};
+
+////////////////////////////////////////////////////////////////////////////////
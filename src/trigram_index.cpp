@@ -0,0 +1,358 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// This file is part of the romato library.
+//
+// Copyright 2013-2026 Rocco Matano
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "romato.h"
+#include "trigram_index.h"
+#include <algorithm>
+
+////////////////////////////////////////////////////////////////////////////////
+
+static bool contains(PCWSTR text, UINT tlen, PCWSTR what, UINT wlen)
+{
+    if (wlen == 0)
+    {
+        return true;
+    }
+    if (wlen > tlen)
+    {
+        return false;
+    }
+    const WCHAR first = what[0];
+    const size_t bytes = wlen * sizeof(WCHAR);
+    for (UINT i = 0, last = tlen - wlen; i <= last; i++)
+    {
+        if (text[i] == first && memcmp(text + i, what, bytes) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void TrigramIndex::to_lower(PCWSTR src, UINT len, Yast& dst)
+{
+    dst = Yast(src, len);
+    if (len)
+    {
+        CharLowerBuffW(dst, len);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void TrigramIndex::collect_trigrams(const Yast& text, cvector<uint64_t>& grams)
+{
+    grams.clear();
+    const UINT len = text.length();
+    PCWSTR p = text;
+    for (UINT i = 0; i + 3 <= len; i++)
+    {
+        grams.push_back(trigram(p + i));
+    }
+    std::sort(grams.begin(), grams.end());
+    grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void TrigramIndex::insert(UINT id, PCWSTR text, UINT len)
+{
+    if (id < m_live.size() && m_live[id])
+    {
+        erase(id);
+    }
+    if (id >= m_texts.size())
+    {
+        m_texts.resize(static_cast<size_t>(id) + 1);
+        m_live.resize(static_cast<size_t>(id) + 1, false);
+    }
+    to_lower(text, len, m_texts[id]);
+    m_live[id] = true;
+    ++m_count;
+    ++m_generation;
+
+    cvector<uint64_t> grams;
+    collect_trigrams(m_texts[id], grams);
+    for (const uint64_t gram : grams)
+    {
+        cvector<UINT>& ids = m_postings[gram];
+        // Ids usually arrive in ascending order.
+        if (ids.empty() || ids.back() < id)
+        {
+            ids.push_back(id);
+        }
+        else
+        {
+            auto it = std::lower_bound(ids.begin(), ids.end(), id);
+            if (it == ids.end() || *it != id)
+            {
+                ids.insert(it, id);
+            }
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void TrigramIndex::erase(UINT id)
+{
+    if (id >= m_live.size() || !m_live[id])
+    {
+        return;
+    }
+    cvector<uint64_t> grams;
+    collect_trigrams(m_texts[id], grams);
+    for (const uint64_t gram : grams)
+    {
+        auto pit = m_postings.find(gram);
+        if (pit == m_postings.end())
+        {
+            continue;
+        }
+        cvector<UINT>& ids = pit->second;
+        auto it = std::lower_bound(ids.begin(), ids.end(), id);
+        if (it != ids.end() && *it == id)
+        {
+            ids.erase(it);
+        }
+        if (ids.empty())
+        {
+            m_postings.erase(pit);
+        }
+    }
+    m_texts[id] = Yast();
+    m_live[id] = false;
+    --m_count;
+    ++m_generation;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void TrigramIndex::clear()
+{
+    m_postings.clear();
+    m_texts.clear();
+    m_live.clear();
+    m_count = 0;
+    ++m_generation;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool TrigramIndex::matches(UINT id, PCWSTR lower_query, UINT len, bool prefix)
+    const
+{
+    if (id >= m_live.size() || !m_live[id])
+    {
+        return false;
+    }
+    const Yast& text = m_texts[id];
+    if (prefix)
+    {
+        return (
+            len <= text.length() &&
+            memcmp(text.str(), lower_query, len * sizeof(WCHAR)) == 0
+            );
+    }
+    return contains(text, text.length(), lower_query, len);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void TrigramIndex::scan(
+    PCWSTR lower_query,
+    UINT len,
+    bool prefix,
+    cvector<UINT>& res
+    ) const
+{
+    const UINT cnt = static_cast<UINT>(m_texts.size());
+    for (UINT id = 0; id < cnt; id++)
+    {
+        if (matches(id, lower_query, len, prefix))
+        {
+            res.push_back(id);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void TrigramIndex::intersect(cvector<UINT>& acc, const cvector<UINT>& other)
+{
+    auto out = acc.begin();
+    if (other.size() > 8 * acc.size())
+    {
+        // 'other' is much longer -> binary search instead of merging
+        auto pos = other.begin();
+        for (const UINT id : acc)
+        {
+            pos = std::lower_bound(pos, other.end(), id);
+            if (pos == other.end())
+            {
+                break;
+            }
+            if (*pos == id)
+            {
+                *out++ = id;
+            }
+        }
+    }
+    else
+    {
+        auto a = acc.begin();
+        auto b = other.begin();
+        while (a != acc.end() && b != other.end())
+        {
+            if (*a < *b)
+            {
+                ++a;
+            }
+            else if (*b < *a)
+            {
+                ++b;
+            }
+            else
+            {
+                *out++ = *a++;
+                ++b;
+            }
+        }
+    }
+    acc.erase(out, acc.end());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void TrigramIndex::find(
+    PCWSTR query,
+    UINT len,
+    bool prefix,
+    cvector<UINT>& result
+    ) const
+{
+    result.clear();
+    Yast lower;
+    to_lower(query, len, lower);
+    if (len < 3)
+    {
+        scan(lower, len, prefix, result);
+        return;
+    }
+
+    cvector<uint64_t> grams;
+    collect_trigrams(lower, grams);
+    cvector<const cvector<UINT>*> lists;
+    lists.reserve(grams.size());
+    for (const uint64_t gram : grams)
+    {
+        auto it = m_postings.find(gram);
+        if (it == m_postings.end())
+        {
+            return;
+        }
+        lists.push_back(&it->second);
+    }
+    std::sort(
+        lists.begin(),
+        lists.end(),
+        [](const cvector<UINT>* a, const cvector<UINT>* b)
+        {
+            return a->size() < b->size();
+        }
+        );
+
+    result = *lists[0];
+    for (size_t i = 1; i < lists.size() && !result.empty(); i++)
+    {
+        intersect(result, *lists[i]);
+    }
+
+    // Containing all trigrams does not imply containing the query.
+    auto out = result.begin();
+    for (const UINT id : result)
+    {
+        if (matches(id, lower, len, prefix))
+        {
+            *out++ = id;
+        }
+    }
+    result.erase(out, result.end());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+const cvector<UINT>& TrigramQuery::update(
+    const TrigramIndex& index,
+    PCWSTR query,
+    UINT len
+    )
+{
+    Yast lower;
+    TrigramIndex::to_lower(query, len, lower);
+
+    // Once the query is long enough to use trigrams, asking the index beats
+    // filtering a result that came from a scan.
+    const UINT old_len = m_query.length();
+    const bool narrows = (
+        m_valid &&
+        m_generation == index.generation() &&
+        len >= old_len &&
+        (old_len >= 3 || len < 3) &&
+        (
+            m_prefix ?
+            memcmp(lower.str(), m_query.str(), old_len * sizeof(WCHAR)) == 0 :
+            contains(lower, len, m_query, old_len)
+            )
+        );
+
+    if (narrows)
+    {
+        auto out = m_result.begin();
+        for (const UINT id : m_result)
+        {
+            if (index.matches(id, lower, len, m_prefix))
+            {
+                *out++ = id;
+            }
+        }
+        m_result.erase(out, m_result.end());
+    }
+    else
+    {
+        index.find(query, len, m_prefix, m_result);
+    }
+
+    m_query = std::move(lower);
+    m_generation = index.generation();
+    m_valid = true;
+    return m_result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,155 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// This file is part of the romato library.
+//
+// Copyright 2013-2026 Rocco Matano
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Inverted trigram index for 'type to filter' in lists.
+//
+// Every entry is identified by a caller supplied id (e.g. a row index or a
+// model row) and holds a lower case copy of its text. For every trigram
+// (three consecutive characters) the index keeps a sorted list of the ids
+// whose text contains it. A query is answered by intersecting the lists of
+// the query's trigrams - starting with the shortest one - and verifying the
+// few remaining candidates. Queries shorter than three characters fall back
+// to scanning all entries.
+//
+// Matching is case insensitive. Ids should be dense, since the texts are
+// stored in a vector indexed by id.
+//
+// TrigramQuery narrows the previous result when the query just grows (as it
+// does while the user types), instead of asking the index again.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+class TrigramIndex
+{
+public:
+
+    TrigramIndex() : m_count(0), m_generation(0)
+    {
+    }
+
+    TrigramIndex(const TrigramIndex&) = delete;
+    TrigramIndex& operator=(const TrigramIndex&) = delete;
+
+    // Adds entry 'id' or replaces its text.
+    void insert(UINT id, PCWSTR text, UINT len);
+
+    void insert(UINT id, PCWSTR text)
+    {
+        insert(id, text, sz_lenW(text));
+    }
+
+    void erase(UINT id);
+    void clear();
+
+    UINT size() const
+    {
+        return m_count;
+    }
+
+    // Incremented by every modification.
+    UINT generation() const
+    {
+        return m_generation;
+    }
+
+    // Ids of all entries containing 'query' (or starting with 'query' if
+    // 'prefix' is true) in ascending order.
+    void find(PCWSTR query, UINT len, bool prefix, cvector<UINT>& result) const;
+
+    // Does entry 'id' match? 'lower_query' must be lower case already.
+    bool matches(UINT id, PCWSTR lower_query, UINT len, bool prefix) const;
+
+    static void to_lower(PCWSTR src, UINT len, Yast& dst);
+
+protected:
+
+    static uint64_t trigram(const WCHAR* p)
+    {
+        return (
+            static_cast<uint64_t>(p[0]) |
+            (static_cast<uint64_t>(p[1]) << 16) |
+            (static_cast<uint64_t>(p[2]) << 32)
+            );
+    }
+
+    static void collect_trigrams(const Yast& text, cvector<uint64_t>& grams);
+    static void intersect(cvector<UINT>& acc, const cvector<UINT>& other);
+
+    void scan(PCWSTR lower_query, UINT len, bool prefix, cvector<UINT>& res) const;
+
+    cumap<uint64_t, cvector<UINT>> m_postings;
+    cvector<Yast> m_texts;              // lower case, indexed by id
+    cvector<bool> m_live;
+    UINT m_count;
+    UINT m_generation;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+class TrigramQuery
+{
+public:
+
+    TrigramQuery(bool prefix = false) :
+        m_prefix(prefix),
+        m_generation(0),
+        m_valid(false)
+    {
+    }
+
+    // Returns the ids matching 'query'. If the previous query was a prefix of
+    // (or, for substring queries, contained in) the new one and the index has
+    // not been modified since, only the previous result is filtered.
+    const cvector<UINT>& update(
+        const TrigramIndex& index,
+        PCWSTR query,
+        UINT len
+        );
+
+    const cvector<UINT>& result() const
+    {
+        return m_result;
+    }
+
+    void reset()
+    {
+        m_valid = false;
+    }
+
+protected:
+
+    bool m_prefix;
+    UINT m_generation;
+    bool m_valid;
+    Yast m_query;       // lower case
+    cvector<UINT> m_result;
+};
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,350 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// This file is part of the romato library.
+//
+// Copyright 2013-2026 Rocco Matano
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "romato.h"
+#include "ui_dispatcher.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+UiDispatcher* UiDispatcher::Create(HWND hWnd)
+{
+    return new UiDispatcher(hWnd);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+UiDispatcher::UiDispatcher(HWND hWnd) :
+    m_head(nullptr),
+    m_wake_pending(false),
+    m_refs(1),
+    m_hWnd(hWnd),
+    m_msg(RegisterWindowMessageW(L"romato:UiDispatcher")),
+    m_thread_id(GetCurrentThreadId()),
+    m_backlog_head(nullptr),
+    m_backlog_tail(nullptr),
+    m_batch_size(256),
+    m_timer_active(false)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+UiDispatcher::~UiDispatcher()
+{
+    // Only the window's reference can trigger Close(), so if the window never
+    // got destroyed, there might still be pending items.
+    if (!IsClosed())
+    {
+        Close();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool UiDispatcher::HandleMessage(
+    UiDispatcher*& dispatcher,
+    UINT msg,
+    WPARAM wp,
+    LPARAM lp
+    )
+{
+    UNUSED(wp);
+    if (dispatcher == nullptr)
+    {
+        return false;
+    }
+    if (msg == dispatcher->m_msg && lp == p2lp(dispatcher))
+    {
+        dispatcher->Drain();
+        return true;
+    }
+    if (msg == WM_NCDESTROY)
+    {
+        dispatcher->Close();
+        dispatcher->Release();
+        dispatcher = nullptr;
+    }
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool UiDispatcher::Post(UI_DISPATCH_FUNC func, void* ctx, intptr_t value)
+{
+    return PostKeyed(0, func, ctx, value);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool UiDispatcher::PostKeyed(
+    intptr_t key,
+    UI_DISPATCH_FUNC func,
+    void* ctx,
+    intptr_t value
+    )
+{
+    auto item = new Item;
+    item->func = func;
+    item->ctx = ctx;
+    item->key = key;
+    item->value = value;
+
+    // As soon as the item is pushed, the UI thread may run or cancel it and
+    // thereby drop the last reference of the caller (e.g. a UiTask frame).
+    // So keep the dispatcher alive until Wake is done.
+    AddRef();
+    const bool pushed = Push(item);
+    if (pushed)
+    {
+        Wake();
+    }
+    else
+    {
+        func(ctx, value, true);
+        delete item;
+    }
+    Release();
+    return pushed;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool UiDispatcher::Push(Item* item)
+{
+    // Treiber stack. Pushing LIFO is fine, since TakePending grabs everything
+    // at once and restores FIFO order.
+    Item* head = m_head.load(std::memory_order_relaxed);
+    do
+    {
+        if (head == closed_marker())
+        {
+            return false;
+        }
+        item->next = head;
+    }
+    while (
+        !m_head.compare_exchange_weak(
+            head,
+            item,
+            std::memory_order_release,
+            std::memory_order_relaxed
+            )
+        );
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void UiDispatcher::Wake()
+{
+    if (!m_wake_pending.exchange(true, std::memory_order_acq_rel))
+    {
+        // The window might be gone already. Close() will deal with any items
+        // that are left. Never post with a nullptr window, as that would
+        // become a thread message of the calling thread.
+        const HWND hWnd = m_hWnd.load(std::memory_order_acquire);
+        if (!hWnd || !::PostMessageW(hWnd, m_msg, 0, p2lp(this)))
+        {
+            m_wake_pending.store(false, std::memory_order_release);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void UiDispatcher::TakePending()
+{
+    // Never replace the closed marker, not even for a moment. Otherwise a
+    // concurrent Push could succeed and its item would be lost.
+    Item* list = m_head.load(std::memory_order_relaxed);
+    do
+    {
+        if (list == closed_marker())
+        {
+            return;
+        }
+    }
+    while (
+        !m_head.compare_exchange_weak(
+            list,
+            nullptr,
+            std::memory_order_acquire,
+            std::memory_order_relaxed
+            )
+        );
+
+    // reverse to restore FIFO order
+    Item* fifo = nullptr;
+    while (list)
+    {
+        Item* const next = list->next;
+        list->next = fifo;
+        fifo = list;
+        list = next;
+    }
+
+    // Append to backlog. Keyed items whose key is already pending are merged
+    // into that pending item (which keeps its position in the queue).
+    while (fifo)
+    {
+        Item* const item = fifo;
+        fifo = fifo->next;
+        item->next = nullptr;
+        if (item->key != 0)
+        {
+            auto it = m_keyed.find(item->key);
+            if (it != m_keyed.end())
+            {
+                // the superseded update is cancelled
+                Item* const pending = it->second;
+                pending->func(pending->ctx, pending->value, true);
+                pending->func = item->func;
+                pending->ctx = item->ctx;
+                pending->value = item->value;
+                delete item;
+                continue;
+            }
+            m_keyed.emplace(item->key, item);
+        }
+        if (m_backlog_tail)
+        {
+            m_backlog_tail->next = item;
+        }
+        else
+        {
+            m_backlog_head = item;
+        }
+        m_backlog_tail = item;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void UiDispatcher::Drain()
+{
+    // Clear the flag BEFORE taking the items. A producer that pushes after
+    // TakePending will then post a new message.
+    m_wake_pending.store(false, std::memory_order_release);
+    TakePending();
+
+    // Keep ourselves alive, since an item might trigger destruction of the
+    // window (and thus the release of the window's reference).
+    AddRef();
+    UINT done = 0;
+    while (m_backlog_head && done < m_batch_size && !IsClosed())
+    {
+        Item* const item = m_backlog_head;
+        m_backlog_head = item->next;
+        if (m_backlog_head == nullptr)
+        {
+            m_backlog_tail = nullptr;
+        }
+        if (item->key != 0)
+        {
+            m_keyed.erase(item->key);
+        }
+        item->func(item->ctx, item->value, false);
+        delete item;
+        ++done;
+    }
+
+    if (!IsClosed())
+    {
+        if (m_backlog_head && !m_timer_active)
+        {
+            // Continue from a timer. WM_TIMER has a lower priority than
+            // WM_PAINT, so the window gets a chance to repaint in between.
+            m_timer_active = 0 != ::SetTimer(
+                m_hWnd.load(std::memory_order_relaxed),
+                p2i<UINT_PTR>(this),
+                USER_TIMER_MINIMUM,
+                TimerProc
+                );
+        }
+        else if (!m_backlog_head && m_timer_active)
+        {
+            ::KillTimer(
+                m_hWnd.load(std::memory_order_relaxed),
+                p2i<UINT_PTR>(this)
+                );
+            m_timer_active = false;
+        }
+    }
+    Release();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void CALLBACK UiDispatcher::TimerProc(HWND hWnd, UINT msg, UINT_PTR id, DWORD ms)
+{
+    UNUSED(hWnd);
+    UNUSED(msg);
+    UNUSED(ms);
+    i2p<UiDispatcher*>(id)->Drain();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void UiDispatcher::Close()
+{
+    if (m_timer_active)
+    {
+        ::KillTimer(
+            m_hWnd.load(std::memory_order_relaxed),
+            p2i<UINT_PTR>(this)
+            );
+        m_timer_active = false;
+    }
+
+    // From now on Push refuses new items.
+    Item* list = m_head.exchange(closed_marker(), std::memory_order_acq_rel);
+    if (list == closed_marker())
+    {
+        list = nullptr;
+    }
+
+    // cancel backlog first (it is older), then the rest
+    Item* item = m_backlog_head;
+    m_backlog_head = m_backlog_tail = nullptr;
+    m_keyed.clear();
+    while (item)
+    {
+        Item* const next = item->next;
+        item->func(item->ctx, item->value, true);
+        delete item;
+        item = next;
+    }
+    while (list)
+    {
+        Item* const next = list->next;
+        list->func(list->ctx, list->value, true);
+        delete list;
+        list = next;
+    }
+    m_hWnd.store(nullptr, std::memory_order_release);
+}
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,182 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// This file is part of the romato library.
+//
+// Copyright 2013-2026 Rocco Matano
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// UiDispatcher transports work from arbitrary threads onto the thread that
+// owns a window, without flooding that thread's message queue.
+//
+// Workers Post() closures (a function pointer plus context and value) into a
+// lock-free queue. Only the first post after the queue has been drained
+// results in a window message. The UI thread then executes the queued items
+// in batches. If there is more work than fits into one batch, the rest is
+// continued from a timer, so that painting and input are not starved.
+//
+// PostKeyed() coalesces updates: if an item with the same key is still
+// pending, the new value simply replaces the pending one. This is what
+// progress updates want - only the latest state matters. The replaced item is
+// called with 'cancelled' == true.
+//
+// Every posted function is called exactly once. If the window has been
+// destroyed before the item could be executed, it is called with
+// 'cancelled' == true (and possibly on the posting thread), so that it can
+// release whatever 'ctx' refers to.
+//
+// Usage in a SimpleWnd or BaseDlg derived class:
+//
+//     // WM_CREATE / OnInitDialog
+//     m_dispatcher = UiDispatcher::Create(m_hWnd);
+//
+//     // OnMessage
+//     if (UiDispatcher::HandleMessage(m_dispatcher, msg, wp, lp))
+//     {
+//         return 0;
+//     }
+//
+// HandleMessage also takes care of WM_NCDESTROY: it cancels pending items,
+// releases the window's reference and sets 'm_dispatcher' to nullptr.
+// Threads that keep a pointer to the dispatcher must hold a reference
+// (AddRef/Release), since the dispatcher may outlive the window.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "container.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+using UI_DISPATCH_FUNC = void(*)(void* ctx, intptr_t value, bool cancelled);
+
+class UiDispatcher
+{
+public:
+
+    // The returned object carries one reference, which is owned by the
+    // window and is released by HandleMessage on WM_NCDESTROY. Must be called
+    // on the thread that owns 'hWnd'.
+    static UiDispatcher* Create(HWND hWnd);
+
+    static bool HandleMessage(
+        UiDispatcher*& dispatcher,
+        UINT msg,
+        WPARAM wp,
+        LPARAM lp
+        );
+
+    void AddRef()
+    {
+        m_refs.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void Release()
+    {
+        if (m_refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            delete this;
+        }
+    }
+
+    // Both can be called from any thread. They return false, if the window
+    // has already been destroyed (in which case 'func' has been called with
+    // 'cancelled' == true).
+    bool Post(UI_DISPATCH_FUNC func, void* ctx, intptr_t value = 0);
+
+    // 'key' must not be 0.
+    bool PostKeyed(
+        intptr_t key,
+        UI_DISPATCH_FUNC func,
+        void* ctx,
+        intptr_t value
+        );
+
+    bool IsUiThread() const
+    {
+        return GetCurrentThreadId() == m_thread_id;
+    }
+
+    bool IsClosed() const
+    {
+        return m_head.load(std::memory_order_acquire) == closed_marker();
+    }
+
+    // Maximum number of items, that are executed per window message or timer
+    // tick. Only to be called on the UI thread.
+    void SetBatchSize(UINT batch_size)
+    {
+        m_batch_size = batch_size ? batch_size : 1;
+    }
+
+protected:
+
+    struct Item
+    {
+        Item* next;
+        UI_DISPATCH_FUNC func;
+        void* ctx;
+        intptr_t key;
+        intptr_t value;
+    };
+
+    static Item* closed_marker()
+    {
+        return i2p<Item*>(1);
+    }
+
+    static void CALLBACK TimerProc(HWND hWnd, UINT msg, UINT_PTR id, DWORD ms);
+
+    UiDispatcher(HWND hWnd);
+    ~UiDispatcher();
+
+    UiDispatcher(const UiDispatcher&) = delete;
+    UiDispatcher& operator=(const UiDispatcher&) = delete;
+
+    bool Push(Item* item);
+    void Wake();
+    void TakePending();
+    void Drain();
+    void Close();
+
+    // shared between threads
+    std::atomic<Item*> m_head;
+    std::atomic<bool> m_wake_pending;
+    std::atomic<LONG> m_refs;
+
+    // Read by Wake() on any thread, cleared by Close() on the UI thread.
+    std::atomic<HWND> m_hWnd;
+
+    // immutable after construction
+    UINT m_msg;
+    DWORD m_thread_id;
+
+    // only accessed by the UI thread
+    Item* m_backlog_head;
+    Item* m_backlog_tail;
+    cumap<intptr_t, Item*> m_keyed;
+    UINT m_batch_size;
+    bool m_timer_active;
+};
+
+////////////////////////////////////////////////////////////////////////////////
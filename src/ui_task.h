@@ -0,0 +1,209 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// This file is part of the romato library.
+//
+// Copyright 2013-2026 Rocco Matano
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// C++20 coroutine support for moving work off the UI thread.
+//
+// A UiTask is a fire-and-forget coroutine. It starts running synchronously on
+// the calling (UI) thread and hops between the UI thread and a ThreadPool by
+// awaiting a UiContext:
+//
+//     UiTask MyDlg::OnCopyFiles()
+//     {
+//         UiContext ui(m_dispatcher);
+//         co_await ui.to_pool(m_pool);
+//         const bool ok = copy_them_all();     // runs on a worker
+//         co_await ui.to_ui();
+//         SetDlgItemText(IDC_STATUS, ok ? L"done" : L"failed");
+//     }
+//
+// If the window is destroyed while the coroutine is on the pool, to_ui() does
+// not resume it. Instead the coroutine frame is destroyed (destructors of
+// locals run as usual), so code after 'co_await ui.to_ui()' can rely on the
+// window (and the object owning it, as long as it lives until WM_NCDESTROY)
+// still being alive.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include <coroutine>
+#include "ui_dispatcher.h"
+#include "thread_pool.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+struct UiTask
+{
+    struct promise_type
+    {
+        UiTask get_return_object() noexcept
+        {
+            return {};
+        }
+
+        std::suspend_never initial_suspend() noexcept
+        {
+            return {};
+        }
+
+        // The frame destroys itself, when the coroutine completes.
+        std::suspend_never final_suspend() noexcept
+        {
+            return {};
+        }
+
+        void return_void() noexcept
+        {
+        }
+
+        void unhandled_exception() noexcept
+        {
+            RaiseException(E_UNEXPECTED);
+        }
+    };
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+class UiContext
+{
+public:
+
+    // Must be constructed on the UI thread, i.e. before the first
+    // co_await. 'dispatcher' may be nullptr, in which case to_ui() always
+    // cancels.
+    explicit UiContext(UiDispatcher* dispatcher) : m_dispatcher(dispatcher)
+    {
+        if (m_dispatcher)
+        {
+            m_dispatcher->AddRef();
+        }
+    }
+
+    ~UiContext()
+    {
+        if (m_dispatcher)
+        {
+            m_dispatcher->Release();
+        }
+    }
+
+    UiContext(const UiContext&) = delete;
+    UiContext& operator=(const UiContext&) = delete;
+
+    // true, once the window has been destroyed
+    bool is_cancelled() const
+    {
+        return m_dispatcher == nullptr || m_dispatcher->IsClosed();
+    }
+
+    struct PoolAwaiter
+    {
+        ThreadPool& pool;
+
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> h) const
+        {
+            pool.submit(resume, h.address());
+        }
+
+        void await_resume() const noexcept
+        {
+        }
+
+        static void resume(void* ctx)
+        {
+            std::coroutine_handle<>::from_address(ctx).resume();
+        }
+    };
+
+    struct UiAwaiter
+    {
+        UiDispatcher* dispatcher;
+
+        bool await_ready() const noexcept
+        {
+            return (
+                dispatcher &&
+                dispatcher->IsUiThread() &&
+                !dispatcher->IsClosed()
+                );
+        }
+
+        void await_suspend(std::coroutine_handle<> h) const
+        {
+            if (dispatcher)
+            {
+                // If the window is already gone, Post calls 'resume' with
+                // cancelled == true, which destroys the frame.
+                dispatcher->Post(resume, h.address());
+            }
+            else
+            {
+                h.destroy();
+            }
+        }
+
+        void await_resume() const noexcept
+        {
+        }
+
+        static void resume(void* ctx, intptr_t value, bool cancelled)
+        {
+            UNUSED(value);
+            auto h = std::coroutine_handle<>::from_address(ctx);
+            if (cancelled)
+            {
+                h.destroy();
+            }
+            else
+            {
+                h.resume();
+            }
+        }
+    };
+
+    PoolAwaiter to_pool(ThreadPool& pool) const
+    {
+        return PoolAwaiter{pool};
+    }
+
+    UiAwaiter to_ui() const
+    {
+        return UiAwaiter{m_dispatcher};
+    }
+
+protected:
+
+    UiDispatcher* m_dispatcher;
+};
+
+////////////////////////////////////////////////////////////////////////////////
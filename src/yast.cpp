@@ -152,6 +152,20 @@ bool Yast::load_res_string(UINT str_id, HINSTANCE h_inst, UINT lang_id)
 
 ////////////////////////////////////////////////////////////////////////////////
 
+bool Yast::load_res_string(UINT str_id, StringTable& table)
+{
+    StringResView view;
+    if (table.lookup(str_id, view))
+    {
+        release(m_str);
+        m_str = allocate(view.str, view.len);
+        return true;
+    }
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 Yast Yast::slice(int begin, int end) const
 {
     const int len = static_cast<int>(length());
@@ -387,13 +401,12 @@ Yast& Yast::reverse()
 
 ////////////////////////////////////////////////////////////////////////////////
 
-size_t Yast::hash() const
+size_t Yast::hash_bytes(const void* data, UINT blen)
 {
     // https://en.wikipedia.org/wiki/Fowler%E2%80%93Noll%E2%80%93Vo_hash_function
     const UINT prime = 16777619U;
     const UINT offset = 2166136261U;
-    auto const bytes = p2p<const BYTE*>(m_str);
-    const UINT blen = byte_length();
+    auto const bytes = p2p<const BYTE*>(data);
     UINT mince = offset;
     for (UINT u = 0; u < blen; u++)
     {
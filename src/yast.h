@@ -453,6 +453,11 @@ public:
         UINT lang_id = MAKELANGID(LANG_NEUTRAL, SUBLANG_NEUTRAL)
         );
 
+    // Same as above, but through the index of a StringTable (see
+    // string_res.h). Faster when many strings are loaded from one module,
+    // but the module must not be unloaded while the table is in use.
+    bool load_res_string(UINT str_id, StringTable& table);
+
     // Python like slicing, with the difference that if the end index is
     // negative it does NOT denote the first character that not a part of the
     // slice, but the last that IS part of the slice.
@@ -483,7 +488,15 @@ public:
 
     Yast& reverse();
 
-    size_t hash() const;
+    size_t hash() const
+    {
+        return hash_bytes(m_str, byte_length());
+    }
+
+    // FNV-1a over arbitrary bytes. Exposed, so that others (e.g. the atom
+    // table) can hash strings, that are not (yet) contained in a Yast, in the
+    // very same way.
+    static size_t hash_bytes(const void* data, UINT blen);
 
     bool to_clipboard(HWND wnd = nullptr) const;
     bool from_clipboard(HWND wnd = nullptr);
@@ -0,0 +1,290 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// This file is part of the romato library.
+//
+// Copyright 2013-2026 Rocco Matano
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "romato.h"
+#include "yast_atom.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Intentionally not an object with a constructor, because static constructors
+// are only executed if ROMATO_CONSTRUCT_STATIC_OBJECTS is set.
+static std::atomic<YastAtomTable*> s_global_table;
+
+////////////////////////////////////////////////////////////////////////////////
+
+YastAtom::YastAtom(PCWSTR p_str) : m_entry(nullptr)
+{
+    *this = YastAtomTable::global().intern(p_str);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+YastAtom::YastAtom(PCWSTR p_str, UINT len) : m_entry(nullptr)
+{
+    *this = YastAtomTable::global().intern(p_str, len);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+YastAtom::YastAtom(const Yast& str) : m_entry(nullptr)
+{
+    *this = YastAtomTable::global().intern(str);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+YastAtomTable::YastAtomTable(UINT num_buckets) :
+    m_buckets(nullptr),
+    m_count(0)
+{
+    if (num_buckets < 16 || !IS_POW_2(num_buckets))
+    {
+        RaiseException(E_INVALIDARG);
+    }
+    InitializeSRWLock(&m_lock);
+    m_buckets.store(alloc_buckets(num_buckets, nullptr));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+YastAtomTable::~YastAtomTable()
+{
+    Buckets* const buckets = m_buckets.load();
+    for (size_t i = 0; i <= buckets->mask; i++)
+    {
+        YastAtomEntry* e = buckets->slots[i].load(std::memory_order_relaxed);
+        while (e)
+        {
+            YastAtomEntry* const next = e->next.load(std::memory_order_relaxed);
+            delete e;
+            e = next;
+        }
+    }
+    Buckets* b = buckets;
+    while (b)
+    {
+        Buckets* const retired = b->retired;
+        free(b);
+        b = retired;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+YastAtomTable::Buckets* YastAtomTable::alloc_buckets(
+    size_t num,
+    Buckets* retired
+    )
+{
+    const size_t size = (
+        sizeof(Buckets) + (num - 1) * sizeof(std::atomic<YastAtomEntry*>)
+        );
+    auto buckets = static_cast<Buckets*>(malloc(size));
+    buckets->mask = num - 1;
+    buckets->retired = retired;
+    for (size_t i = 0; i < num; i++)
+    {
+        buckets->slots[i].store(nullptr, std::memory_order_relaxed);
+    }
+    return buckets;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+YastAtomEntry* YastAtomTable::lookup(PCWSTR p_str, UINT len, size_t hash) const
+{
+    // A concurrent grow() might relink the chain we are walking. That can
+    // make us miss an entry, but never lets us run into garbage, since
+    // entries are only freed by purge() and old bucket arrays are kept until
+    // the table is destroyed. Callers retry under the lock after a miss.
+    const Buckets* const buckets = m_buckets.load(std::memory_order_acquire);
+    YastAtomEntry* e = buckets->slots[hash & buckets->mask].load(
+        std::memory_order_acquire
+        );
+    const UINT blen = len * sizeof(WCHAR);
+    while (e)
+    {
+        if (
+            e->hash == hash &&
+            e->str.byte_length() == blen &&
+            memcmp(e->str.str(), p_str, blen) == 0
+            )
+        {
+            return e;
+        }
+        e = e->next.load(std::memory_order_acquire);
+    }
+    return nullptr;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+YastAtom YastAtomTable::intern(PCWSTR p_str, UINT len)
+{
+    if (p_str == nullptr)
+    {
+        p_str = L"";
+        len = 0;
+    }
+    const size_t hash = Yast::hash_bytes(p_str, len * sizeof(WCHAR));
+
+    // fast path: no lock
+    YastAtomEntry* e = lookup(p_str, len, hash);
+    if (e == nullptr)
+    {
+        AcquireSRWLockExclusive(&m_lock);
+        e = lookup(p_str, len, hash);
+        if (e == nullptr)
+        {
+            if (m_count >= 2 * (m_buckets.load()->mask + 1))
+            {
+                grow();
+            }
+            Buckets* const buckets = m_buckets.load();
+            auto& slot = buckets->slots[hash & buckets->mask];
+            e = new YastAtomEntry(p_str, len, hash);
+            e->next.store(slot.load(std::memory_order_relaxed));
+            slot.store(e, std::memory_order_release);
+            ++m_count;
+        }
+        // Take the reference while still holding the lock, so that this is
+        // the same for new and existing entries.
+        InterlockedIncrement(&e->refs);
+        ReleaseSRWLockExclusive(&m_lock);
+        return YastAtom(e);
+    }
+    InterlockedIncrement(&e->refs);
+    return YastAtom(e);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+YastAtom YastAtomTable::find(PCWSTR p_str, UINT len) const
+{
+    if (p_str == nullptr)
+    {
+        p_str = L"";
+        len = 0;
+    }
+    const size_t hash = Yast::hash_bytes(p_str, len * sizeof(WCHAR));
+    YastAtomEntry* e = lookup(p_str, len, hash);
+    if (e == nullptr)
+    {
+        // might have missed it because of a concurrent grow()
+        auto lock = const_cast<SRWLOCK*>(&m_lock);
+        AcquireSRWLockShared(lock);
+        e = lookup(p_str, len, hash);
+        if (e)
+        {
+            InterlockedIncrement(&e->refs);
+        }
+        ReleaseSRWLockShared(lock);
+        return YastAtom(e);
+    }
+    InterlockedIncrement(&e->refs);
+    return YastAtom(e);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Must be called with m_lock held exclusively.
+void YastAtomTable::grow()
+{
+    Buckets* const old_b = m_buckets.load();
+    const size_t num = (old_b->mask + 1) * 4;
+    Buckets* const new_b = alloc_buckets(num, old_b);
+    for (size_t i = 0; i <= old_b->mask; i++)
+    {
+        YastAtomEntry* e = old_b->slots[i].load(std::memory_order_relaxed);
+        while (e)
+        {
+            YastAtomEntry* const next = e->next.load(std::memory_order_relaxed);
+            auto& slot = new_b->slots[e->hash & new_b->mask];
+            e->next.store(
+                slot.load(std::memory_order_relaxed),
+                std::memory_order_release
+                );
+            slot.store(e, std::memory_order_relaxed);
+            e = next;
+        }
+    }
+    m_buckets.store(new_b, std::memory_order_release);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+UINT YastAtomTable::purge()
+{
+    UINT purged = 0;
+    AcquireSRWLockExclusive(&m_lock);
+    Buckets* const buckets = m_buckets.load();
+    for (size_t i = 0; i <= buckets->mask; i++)
+    {
+        std::atomic<YastAtomEntry*>* link = &buckets->slots[i];
+        YastAtomEntry* e = link->load();
+        while (e)
+        {
+            YastAtomEntry* const next = e->next.load();
+            if (e->refs == 0)
+            {
+                link->store(next);
+                delete e;
+                ++purged;
+            }
+            else
+            {
+                link = &e->next;
+            }
+            e = next;
+        }
+    }
+    m_count -= purged;
+    ReleaseSRWLockExclusive(&m_lock);
+    return purged;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+YastAtomTable& YastAtomTable::global()
+{
+    YastAtomTable* table = s_global_table.load(std::memory_order_acquire);
+    if (table == nullptr)
+    {
+        auto candidate = new YastAtomTable();
+        if (s_global_table.compare_exchange_strong(table, candidate))
+        {
+            table = candidate;
+        }
+        else
+        {
+            // some other thread was faster
+            delete candidate;
+        }
+    }
+    return *table;
+}
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,278 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// This file is part of the romato library.
+//
+// Copyright 2013-2026 Rocco Matano
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// YastAtom is a handle to an interned string. Interning the same characters
+// twice yields the very same handle, so handles can be compared and hashed
+// by pointer instead of comparing and hashing the characters over and over
+// again. That makes them well suited as keys for cumap and the like (see
+// std::hash<YastAtom> below).
+//
+// Atoms are reference counted. Entries whose count has dropped to zero stay in
+// the table (they will simply be revived by the next intern) until purge() is
+// called.
+//
+// Looking up an atom that already exists does not take any lock, so worker
+// threads may intern concurrently. Only creating a new entry (or growing the
+// table) serializes on an SRW lock.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "yast.h"
+#include <atomic>
+
+////////////////////////////////////////////////////////////////////////////////
+
+struct YastAtomEntry
+{
+    std::atomic<YastAtomEntry*> next;
+    volatile LONG refs;
+    size_t hash;
+    Yast str;
+
+    YastAtomEntry(PCWSTR p_str, UINT len, size_t h) :
+        next(nullptr),
+        refs(0),
+        hash(h),
+        str(p_str, len)
+    {
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+class YastAtomTable;
+
+class YastAtom
+{
+protected:
+
+    YastAtomEntry* m_entry;
+
+    friend class YastAtomTable;
+
+    // Only YastAtomTable creates atoms from entries and it has already
+    // incremented the reference count.
+    explicit YastAtom(YastAtomEntry* entry) : m_entry(entry)
+    {
+    }
+
+    void add_ref() const
+    {
+        if (m_entry)
+        {
+            InterlockedIncrement(&m_entry->refs);
+        }
+    }
+
+    void release()
+    {
+        if (m_entry)
+        {
+            InterlockedDecrement(&m_entry->refs);
+        }
+    }
+
+public:
+
+    // The null atom. It represents the empty string, but it is NOT equal to
+    // an atom that was created by interning an empty string.
+    YastAtom() : m_entry(nullptr)
+    {
+    }
+
+    YastAtom(const YastAtom& src) : m_entry(src.m_entry)
+    {
+        add_ref();
+    }
+
+    YastAtom(YastAtom&& src) : m_entry(src.m_entry)
+    {
+        src.m_entry = nullptr;
+    }
+
+    // Intern into the global table.
+    explicit YastAtom(PCWSTR p_str);
+    YastAtom(PCWSTR p_str, UINT len);
+    explicit YastAtom(const Yast& str);
+
+    ~YastAtom()
+    {
+        release();
+    }
+
+    YastAtom& operator=(const YastAtom& src)
+    {
+        if (m_entry != src.m_entry)
+        {
+            src.add_ref();
+            release();
+            m_entry = src.m_entry;
+        }
+        return *this;
+    }
+
+    YastAtom& operator=(YastAtom&& src)
+    {
+        YastAtomEntry* const tmp = m_entry;
+        m_entry = src.m_entry;
+        src.m_entry = tmp;
+        return *this;
+    }
+
+    bool is_null() const
+    {
+        return m_entry == nullptr;
+    }
+
+    // The interned string stays valid as long as this atom is alive.
+    PCWSTR str() const
+    {
+        return m_entry ? m_entry->str.str() : L"";
+    }
+
+    operator PCWSTR() const
+    {
+        return str();
+    }
+
+    UINT length() const
+    {
+        return m_entry ? m_entry->str.length() : 0;
+    }
+
+    Yast to_yast() const
+    {
+        return m_entry ? m_entry->str : Yast();
+    }
+
+    // Handles are unique, so comparing the pointers is sufficient.
+    bool operator==(const YastAtom& cmp) const
+    {
+        return m_entry == cmp.m_entry;
+    }
+
+    bool operator!=(const YastAtom& cmp) const
+    {
+        return m_entry != cmp.m_entry;
+    }
+
+    // Only suitable for ordered containers, NOT for sorting alphabetically.
+    bool operator<(const YastAtom& cmp) const
+    {
+        return m_entry < cmp.m_entry;
+    }
+
+    size_t hash() const
+    {
+        // Entries are at least 8 byte aligned, so the low bits carry no
+        // information. Mix in the upper bits to get a decent distribution for
+        // power of two sized hash tables.
+        const uintptr_t p = p2i<uintptr_t>(m_entry) >> 3;
+        return static_cast<size_t>(p ^ (p >> 15));
+    }
+};
+
+static_assert(sizeof(YastAtom) == sizeof(void*), "Unexpected size of YastAtom");
+
+////////////////////////////////////////////////////////////////////////////////
+
+class YastAtomTable
+{
+public:
+
+    // 'num_buckets' has to be a power of two. The table grows on demand.
+    explicit YastAtomTable(UINT num_buckets = 1024);
+    ~YastAtomTable();
+
+    YastAtomTable(const YastAtomTable&) = delete;
+    YastAtomTable& operator=(const YastAtomTable&) = delete;
+
+    YastAtom intern(PCWSTR p_str, UINT len);
+
+    YastAtom intern(PCWSTR p_str)
+    {
+        return intern(p_str, p_str ? sz_lenW(p_str) : 0);
+    }
+
+    YastAtom intern(const Yast& str)
+    {
+        return intern(str, str.length());
+    }
+
+    // Like intern, but never creates a new entry. Returns the null atom if
+    // the string has not been interned before.
+    YastAtom find(PCWSTR p_str, UINT len) const;
+
+    // Free all entries that are not referenced any more. This must NOT be
+    // called while other threads might intern or find atoms in this table.
+    UINT purge();
+
+    UINT size() const
+    {
+        return m_count;
+    }
+
+    // The table that is used by the interning constructors of YastAtom. It is
+    // created on first use.
+    static YastAtomTable& global();
+
+protected:
+
+    struct Buckets
+    {
+        size_t mask;
+        Buckets* retired;
+        std::atomic<YastAtomEntry*> slots[ANYSIZE_ARRAY];
+    };
+
+    static Buckets* alloc_buckets(size_t num, Buckets* retired);
+    YastAtomEntry* lookup(PCWSTR p_str, UINT len, size_t hash) const;
+    void grow();
+
+    std::atomic<Buckets*> m_buckets;
+    SRWLOCK m_lock;
+    UINT m_count;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Inject specialization of std::hash into namespace std, so that YastAtom can
+// be used as the key type of cumap with O(1) hashing.
+namespace std
+{
+    template<> struct hash<YastAtom>
+    {
+        size_t operator()(YastAtom const& a) const noexcept
+        {
+            return a.hash();
+        }
+    };
+}
+
+////////////////////////////////////////////////////////////////////////////////